@@ -0,0 +1,247 @@
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+/*
+ * a bitmap of `size()' bytes for the tables of the solver, made of blocks
+ * of a page (BLOCK_BITS() bits). a block is kept
+ *  - as the list of its set bits while it has at most SPARSE_MAX() of them,
+ *  - as its bytes in the dense array once more bits are set (DENSE()).
+ * the dense bytes of a sparse block are not used, so they are not even
+ * mapped (see HugePages), and the probes and the snapshots of a table with
+ * few positions set only touch the lists.
+ * test() and set_atomic() may be called from several threads at once, and
+ * set() by the thread which owns the block (a chunk of TableMaker). a list
+ * is only appended to, so test() reads it without the lock of the block.
+ * dense() makes all blocks dense, for the code which reads the words of
+ * the table (SliceKernel), and adapt() does it when most of them are
+ * dense.
+ */
+class BitTable {
+public:
+  static constexpr uint64_t BLOCK_BITS() { return 8 * 4096; }
+  static constexpr uint64_t BLOCK_BYTES() { return BLOCK_BITS() / 8; }
+  static constexpr int SPARSE_MAX() { return 32; }
+  static constexpr uint8_t DENSE() { return 0xff; }
+private:
+  std::vector<uint8_t, HugePageAllocator<uint8_t>> bytes;
+  uint64_t n_blocks = 0;
+  // the number of bits in the list of each block, or DENSE()
+  std::unique_ptr<std::atomic<uint8_t>[]> fill;
+  // the lists (the bit offsets in the block) of SPARSE_MAX() entries each
+  std::vector<uint16_t, HugePageAllocator<uint16_t>> entries;
+  // all blocks are dense, and test() and set() do not look at `fill'
+  bool all_dense = false;
+
+  static std::mutex& lock(uint64_t b) {
+    static std::mutex m[256];
+    return m[b % 256];
+  }
+  uint16_t *list(uint64_t b) {
+    return &entries[b * SPARSE_MAX()];
+  }
+  uint16_t const* list(uint64_t b) const {
+    return &entries[b * SPARSE_MAX()];
+  }
+  void set_dense(uint64_t pos, bool atomic) {
+    uint8_t mask = 1 << (pos % 8);
+    if (atomic)
+      __atomic_fetch_or(&bytes[pos / 8], mask, __ATOMIC_RELAXED);
+    else
+      bytes[pos / 8] |= mask;
+  }
+  bool test_dense(uint64_t pos) const {
+    return (bytes[pos / 8] & (1 << (pos % 8))) != 0;
+  }
+  bool test_sparse(uint64_t b, uint8_t n, uint64_t pos) const {
+    uint16_t off = pos % BLOCK_BITS();
+    uint16_t const* e = list(b);
+    return std::find(e, e + n, off) != e + n;
+  }
+  bool set_sparse(uint64_t pos, bool atomic) {
+    uint64_t b = pos / BLOCK_BITS();
+    std::lock_guard<std::mutex> g(lock(b));
+    uint8_t n = fill[b].load(std::memory_order_relaxed);
+    if (n == DENSE()) {
+      if (test_dense(pos)) return false;
+      set_dense(pos, atomic);
+      return true;
+    }
+    uint16_t off = pos % BLOCK_BITS(), *e = list(b);
+    if (std::find(e, e + n, off) != e + n) return false;
+    if (n < SPARSE_MAX()) {
+      e[n] = off;
+      fill[b].store(n + 1, std::memory_order_release);
+      return true;
+    }
+    for (int i = 0; i < n; i++) set_dense(b * BLOCK_BITS() + e[i], false);
+    set_dense(pos, false);
+    fill[b].store(DENSE(), std::memory_order_release);
+    return true;
+  }
+public:
+  BitTable() = default;
+  explicit BitTable(size_t size)
+    :bytes(size), n_blocks((size + BLOCK_BYTES() - 1) / BLOCK_BYTES()),
+     fill(new std::atomic<uint8_t>[n_blocks]()), entries(n_blocks * SPARSE_MAX()) {}
+  BitTable(BitTable const& t) {
+    *this = t;
+  }
+  BitTable(BitTable&&) = default;
+  BitTable& operator=(BitTable&&) = default;
+  /*
+   * only the lists and the dense blocks are copied
+   */
+  BitTable& operator=(BitTable const& t) {
+    if (this == &t) return *this;
+    if (size() != t.size()) *this = BitTable(t.size());
+    for (uint64_t b = 0; b < n_blocks; b++) {
+      uint8_t n = t.fill[b].load(std::memory_order_relaxed);
+      uint8_t *d = &bytes[b * BLOCK_BYTES()];
+      if (n == DENSE())
+	std::memcpy(d, &t.bytes[b * BLOCK_BYTES()], block_size(b));
+      else {
+	if (fill[b].load(std::memory_order_relaxed) == DENSE()) std::memset(d, 0, block_size(b));
+	std::copy(t.list(b), t.list(b) + n, list(b));
+      }
+      fill[b].store(n, std::memory_order_relaxed);
+    }
+    all_dense = t.all_dense;
+    return *this;
+  }
+  size_t size() const {
+    return bytes.size();
+  }
+  uint64_t blocks() const {
+    return n_blocks;
+  }
+  size_t block_size(uint64_t b) const {
+    return std::min<size_t>(BLOCK_BYTES(), size() - b * BLOCK_BYTES());
+  }
+  bool test(uint64_t pos) const {
+    uint64_t b = pos / BLOCK_BITS();
+    if (all_dense) return test_dense(pos);
+    uint8_t n = fill[b].load(std::memory_order_acquire);
+    if (n == DENSE()) return test_dense(pos);
+    return test_sparse(b, n, pos);
+  }
+  /*
+   * start loading the bytes test(pos) reads (the fill of the block, and
+   * the byte of pos if the block is dense)
+   */
+  void prefetch(uint64_t pos) const {
+    if (!all_dense) __builtin_prefetch(&fill[pos / BLOCK_BITS()]);
+    __builtin_prefetch(&bytes[pos / 8]);
+  }
+  void set(uint64_t pos) {
+    if (all_dense || fill[pos / BLOCK_BITS()].load(std::memory_order_acquire) == DENSE())
+      set_dense(pos, false);
+    else
+      set_sparse(pos, false);
+  }
+  /*
+   * returns true if the bit was not set before
+   */
+  bool set_atomic(uint64_t pos) {
+    if (!all_dense && fill[pos / BLOCK_BITS()].load(std::memory_order_acquire) != DENSE())
+      return set_sparse(pos, true);
+    uint8_t mask = (1 << (pos % 8));
+    return (__atomic_fetch_or(&bytes[pos / 8], mask, __ATOMIC_RELAXED) & mask) == 0;
+  }
+  bool is_dense(uint64_t b) const {
+    return fill[b].load(std::memory_order_relaxed) == DENSE();
+  }
+  uint64_t dense_blocks() const {
+    uint64_t r = 0;
+    for (uint64_t b = 0; b < n_blocks; b++) r += is_dense(b);
+    return r;
+  }
+  /*
+   * block b has no bits set
+   */
+  bool empty(uint64_t b) const {
+    if (!is_dense(b)) return sparse_bits(b) == 0;
+    uint8_t const* d = &bytes[b * BLOCK_BYTES()];
+    return std::all_of(d, d + block_size(b), [](uint8_t x) { return x == 0; });
+  }
+  /*
+   * the number of bits in the list of block b (0 if it is dense)
+   */
+  int sparse_bits(uint64_t b) const {
+    uint8_t n = fill[b].load(std::memory_order_relaxed);
+    return (n == DENSE() ? 0 : n);
+  }
+  /*
+   * the bytes of block b, made in buf (BLOCK_BYTES()) if it is sparse
+   */
+  uint8_t const* block(uint64_t b, uint8_t *buf) const {
+    uint8_t n = fill[b].load(std::memory_order_acquire);
+    if (n == DENSE()) return &bytes[b * BLOCK_BYTES()];
+    std::memset(buf, 0, BLOCK_BYTES());
+    for (uint16_t const* e = list(b); e != list(b) + n; e++) buf[*e / 8] |= 1 << (*e % 8);
+    return buf;
+  }
+  /*
+   * set block b to the bytes of src (single thread)
+   */
+  void load_block(uint64_t b, uint8_t const* src) {
+    size_t n = block_size(b);
+    int c = 0;
+    for (size_t j = 0; j < n && c <= SPARSE_MAX(); j++) c += __builtin_popcount(src[j]);
+    if (c > SPARSE_MAX() || all_dense) {
+      std::memcpy(&bytes[b * BLOCK_BYTES()], src, n);
+      fill[b].store(DENSE(), std::memory_order_relaxed);
+      return;
+    }
+    if (fill[b].load(std::memory_order_relaxed) == DENSE()) std::memset(&bytes[b * BLOCK_BYTES()], 0, n);
+    uint16_t *e = list(b);
+    for (size_t j = 0; j < n; j++)
+      for (uint8_t d = src[j]; d != 0; d &= d - 1) *e++ = j * 8 + __builtin_ctz(d);
+    fill[b].store(c, std::memory_order_relaxed);
+  }
+  uint64_t count() const {
+    uint64_t r = 0;
+    for (uint64_t b = 0; b < n_blocks; b++) {
+      if (!is_dense(b)) {
+	r += sparse_bits(b);
+	continue;
+      }
+      uint8_t const* d = &bytes[b * BLOCK_BYTES()];
+      for (size_t j = 0; j < block_size(b); j++) r += __builtin_popcount(d[j]);
+    }
+    return r;
+  }
+  /*
+   * the dense array (without making the blocks dense, e.g. to place the
+   * pages)
+   */
+  uint8_t *data() {
+    return &bytes[0];
+  }
+  /*
+   * make all blocks dense (single thread), and return the dense array
+   */
+  uint8_t *dense() {
+    for (uint64_t b = 0; b < n_blocks; b++) {
+      uint8_t n = fill[b].load(std::memory_order_relaxed);
+      if (n == DENSE()) continue;
+      for (int i = 0; i < n; i++) set_dense(b * BLOCK_BITS() + list(b)[i], false);
+      fill[b].store(DENSE(), std::memory_order_relaxed);
+    }
+    all_dense = true;
+    return &bytes[0];
+  }
+  /*
+   * make all blocks dense once most of them are (between the sweeps), as
+   * the lists of the few sparse blocks left do not pay for the test of the
+   * fill of a block in every probe. returns true if the table is dense.
+   */
+  bool adapt() {
+    if (!all_dense && dense_blocks() * 4 >= blocks() * 3) dense();
+    return all_dense;
+  }
+};
@@ -9,6 +9,7 @@
 #include <cassert>
 #include <cctype>
 #include <type_traits>
+#include <cmath>
 
 typedef std::vector<int> vI;
 typedef std::pair<int, int> II;
@@ -69,6 +70,57 @@ static inline bool operator!=(PointSetIterator const& x,
   return x.val() != y.val();
 }
 
+/*
+ * binomial coefficients and the combinatorial number system.
+ * rank() numbers the subsets of the same size in increasing order of
+ * their bit patterns (colexicographic order) from 0.
+ */
+class Combination {
+  uint64_t c[65][65];
+public:
+  Combination() {
+    for (int n = 0; n <= 64; n++) {
+      c[n][0] = 1;
+      for (int k = 1; k <= 64; k++)
+	c[n][k] = (n == 0 ? 0 : c[n - 1][k - 1] + c[n - 1][k]);
+    }
+  }
+  uint64_t binomial(int n, int k) const {
+    if (k < 0 || n < k) return 0;
+    return c[n][k];
+  }
+  uint64_t rank(uint64_t subset) const {
+    uint64_t r = 0;
+    for (int i = 1; subset != 0; i++) {
+      r += c[bsf(subset)][i];
+      subset &= subset - 1;
+    }
+    return r;
+  }
+  uint64_t unrank(uint64_t r, int k) const {
+    uint64_t subset = 0;
+    int n = 64;
+    for (; k > 0; k--) {
+      do {
+	n--;
+      } while (c[n][k] > r);
+      r -= c[n][k];
+      subset |= (1ull << n);
+    }
+    return subset;
+  }
+  /*
+   * the next subset of the same size (Gosper's hack)
+   */
+  static uint64_t next(uint64_t subset) {
+    if (subset == 0) return 0;
+    uint64_t t = subset | (subset - 1);
+    return (t + 1) | (((~t & -~t) - 1) >> (bsf(subset) + 1));
+  }
+};
+
+static Combination combination;
+
 class PointSet {
   uint64_t v;
 public:
@@ -184,6 +236,49 @@ public:
   }
 };
 
+/*
+ * iterates over the predecessors of b_v (see Board::prev_states_slow()).
+ * to   : the point of the piece which has moved into b_v
+ * ps1  : the candidate points where the piece has come from
+ * pairs, subset : capture pairs around `to' restored by the black move
+ */
+template<int SIZE>
+class Board_prev_iterator {
+public:
+  uint64_t b_v;
+  int to;
+  PointSetIterator ps0;
+  PointSetIterator ps1;
+  uint64_t pairs[4];
+  int pairs_size;
+  uint64_t allowed;
+  uint64_t subset;
+  Board_prev_iterator(uint64_t b_v_, uint64_t ps0_, uint64_t ps1_) :b_v(b_v_), ps0(ps0_), ps1(ps1_), pairs_size(0), allowed(0), subset(0) {}
+  explicit Board_prev_iterator(uint64_t b_v_) ;
+  uint64_t operator*() noexcept;
+  Board_prev_iterator operator++() noexcept;
+  Board_prev_iterator operator++(int) noexcept {
+    Board_prev_iterator old = *this;
+    ++(*this);
+    return old;
+  }
+private:
+  void set_allowed() noexcept;
+};
+
+template<int SIZE>
+class Board_prev_states {
+  uint64_t v;
+public:
+  explicit Board_prev_states(uint64_t v_) :v(v_) {}
+  Board_prev_iterator<SIZE> begin() const {
+    return Board_prev_iterator<SIZE>(v);
+  }
+  Board_prev_iterator<SIZE> end() const {
+    return Board_prev_iterator<SIZE>(v, 0, 0);
+  }
+};
+
 
 template<int SIZE>
 class Board {
@@ -239,7 +334,7 @@ class Board {
     uint64_t bpos = index >> (SIZE - 1);
     uint64_t v = (index & ((1ull << bpos) - 1));
     v |= (index & ((1ull << (SIZE - 1)) - 1) & ~((1ull << bpos) - 1)) << 1;
-    return Board((turn << bpos) | v | (bpos << SIZE));
+    return Board((static_cast<uint64_t>(turn) << bpos) | v | (bpos << SIZE));
   }
   uint64_t to_index() const {
     uint64_t r = browns().val();
@@ -435,6 +530,7 @@ class Board {
     return r;
   }
   static PointSet neighbors(int pos);
+  static PointSet captures(int pos, int i);
   void remove_browns_slow(int pos) {
     auto [x, y] = XY(pos);
     vI ns = neighbors_slow(pos);
@@ -507,11 +603,63 @@ class Board {
     }
     return r;
   }
+  /**
+   * positions from which one move leads to this position.
+   * a black piece at ppos() may have come from any empty neighbor,
+   * restoring any subset of the empty capture pairs around ppos()
+   * which does not contain the origin.
+   */
+  std::vector<Board<SIZE> > prev_states_slow(bool debug=false) const {
+    std::vector<Board<SIZE> > r;
+    if (debug) std::cerr << "turn()=" << turn() << std::endl;
+    if (turn() == brown) {
+      int ppos_ = ppos();
+      std::vector<uint64_t> empty_pairs;
+      for (int i = 0; i < 4; i++) {
+	uint64_t c2 = captures(ppos_, i).val();
+	if (c2 == 0ull) break;
+	if ((v & c2) == c2) return r;
+	if ((pieces().val() & c2) == 0ull) empty_pairs.push_back(c2);
+      }
+      for (int pos : movable(ppos_)) {
+	if (debug) std::cerr << "pos=" << pos << std::endl;
+	for (uint64_t subset = 0; subset < (1ull << empty_pairs.size()); subset++) {
+	  uint64_t restored = 0ull;
+	  for (size_t i = 0; i < empty_pairs.size(); i++) {
+	    if ((subset & (1ull << i)) != 0) restored |= empty_pairs[i];
+	  }
+	  if ((restored & (1ull << pos)) != 0) continue;
+	  Board prev = *this;
+	  prev.set_ppos(pos);
+	  prev.v |= restored;
+	  prev.flip_turn();
+	  r.push_back(prev);
+	}
+      }
+    }
+    else {
+      for (int tPos : browns()) {
+	if (debug) std::cerr << "tPos=" << tPos << std::endl;
+	for (int fPos : movable(tPos)) {
+	  if (debug) std::cerr << "fPos=" << fPos << std::endl;
+	  Board prev = *this;
+	  prev.v ^= ((1ull << fPos) | (1ull << tPos));
+	  prev.flip_turn();
+	  r.push_back(prev);
+	}
+      }
+    }
+    return r;
+  }
   Board next_states(bool debug=false) const {
     // std::cerr << "next_states()" << std::endl;
     return *this;
   }
   std::vector<Board> next_states_v(bool debug=false) const;
+  Board_prev_states<SIZE> prev_states() const {
+    return Board_prev_states<SIZE>(v);
+  }
+  std::vector<Board> prev_states_v() const;
   Board_iterator<SIZE> begin() const;
   Board_iterator<SIZE> end() const;
   /**
@@ -607,6 +755,13 @@ inline PointSet Board<SIZE>::neighbors(int pos) {
   else if (SIZE == 33) return board33Table.neighbors(pos);
 }
 
+template<int SIZE>
+inline PointSet Board<SIZE>::captures(int pos, int i) {
+  if (SIZE == 25) return board25Table.c2[pos][i];
+  else if (SIZE == 31) return board31Table.c2[pos][i];
+  else return board33Table.c2[pos][i];
+}
+
 template<int SIZE>
 inline void Board<SIZE>::remove_browns(int pos) {
   for (int i = 0; i < 4; i++) {
@@ -709,6 +864,90 @@ Board_iterator<SIZE> Board<SIZE>::end() const {
   return Board_iterator<SIZE>(v, 0, 0);
 }
 
+template<int SIZE>
+Board_prev_iterator<SIZE>::Board_prev_iterator(uint64_t b_v_) :b_v(b_v_), ps0(0), ps1(0), pairs_size(0), allowed(0), subset(0) {
+  Board<SIZE> b(b_v);
+  if (b.turn() == Board<SIZE>::black) {
+    ps0 = b.browns().begin();
+    while (ps1.empty() && !ps0.empty()) {
+      to = *ps0;
+      ++ps0;
+      ps1 = b.movable(to).begin();
+    }
+  } else {
+    to = b.ppos();
+    uint64_t pieces = b.pieces().val();
+    for (int i = 0; i < 4; i++) {
+      uint64_t c2 = Board<SIZE>::captures(to, i).val();
+      if (c2 == 0ull) break;
+      // a pair of browns around `to' would have been captured
+      if ((b_v & c2) == c2) return;
+      if ((pieces & c2) == 0ull) pairs[pairs_size++] = c2;
+    }
+    ps1 = b.movable(to).begin();
+    if (!ps1.empty()) set_allowed();
+  }
+}
+
+template<int SIZE>
+void Board_prev_iterator<SIZE>::set_allowed() noexcept {
+  int from = *ps1;
+  allowed = 0;
+  for (int i = 0; i < pairs_size; i++) {
+    if ((pairs[i] & (1ull << from)) == 0) allowed |= (1ull << i);
+  }
+  subset = 0;
+}
+
+template<int SIZE>
+bool operator!=(Board_prev_iterator<SIZE> const& a, Board_prev_iterator<SIZE> const& b) {
+  return a.ps0 != b.ps0 || a.ps1 != b.ps1;
+}
+
+template<int SIZE>
+uint64_t Board_prev_iterator<SIZE>::operator*() noexcept {
+  Board<SIZE> prev(b_v);
+  int from = *ps1;
+  if (prev.turn() == Board<SIZE>::brown) {
+    prev.set_ppos(from);
+    for (PointSetIterator it(subset); !it.empty(); ++it) {
+      prev.v |= pairs[*it];
+    }
+  } else {
+    prev.v ^= ((1ull << from) | (1ull << to));
+  }
+  prev.flip_turn();
+  return prev.v;
+}
+
+template<int SIZE>
+Board_prev_iterator<SIZE> Board_prev_iterator<SIZE>::operator++() noexcept {
+  if (Board<SIZE>(b_v).turn() == Board<SIZE>::brown) {
+    // next subset of the allowed pairs
+    subset = (subset - allowed) & allowed;
+    if (subset != 0) return *this;
+    ++ps1;
+    if (!ps1.empty()) set_allowed();
+    return *this;
+  }
+  ++ps1;
+  while (ps1.empty() && !ps0.empty()) {
+    to = *ps0;
+    ++ps0;
+    ps1 = Board<SIZE>(b_v).movable(to).begin();
+  }
+  return *this;
+}
+
+template<int SIZE>
+std::vector<Board<SIZE> > Board<SIZE>::prev_states_v() const {
+  std::vector<Board<SIZE>> r;
+  for (auto b : prev_states()) {
+    r.push_back(Board<SIZE>(b));
+  }
+  return r;
+}
+
 template<int SIZE>
 std::vector<Board<SIZE> > Board<SIZE>::next_states_v(bool debug) const {
 //  std::cerr << "next_states_v()" << std::endl;
@@ -719,7 +958,325 @@ std::vector<Board<SIZE> > Board<SIZE>::next_states_v(bool debug) const {
   return r;
 }
 
+/*
+ * index of the positions which can appear in a game.
+ * a game starts with 16 browns and a capture removes pairs of browns,
+ * so only the positions with an even number (<= 16) of browns are numbered.
+ * the index is ordered by the number of browns k, then by ppos (< PPOS_SIZE)
+ * and then by the rank of the browns (see Combination) :
+ *   offset(k) + ppos * C(SIZE - 1, k) + rank(browns)
+ */
+template<int SIZE, int PPOS_SIZE, int MAX_BROWNS>
+struct CompactOffsets {
+  uint64_t v[MAX_BROWNS / 2 + 2];
+  static constexpr uint64_t binomial(int n, int k) {
+    uint64_t r = 1;
+    for (int i = 1; i <= k; i++)
+      r = r * (n - k + i) / i;
+    return r;
+  }
+  constexpr CompactOffsets() :v() {
+    for (int k = 0; k <= MAX_BROWNS; k += 2)
+      v[k / 2 + 1] = v[k / 2] + PPOS_SIZE * binomial(SIZE - 1, k);
+  }
+};
+
+template<int SIZE, int PPOS_SIZE>
+class CompactIndex {
+  static constexpr CompactOffsets<SIZE, PPOS_SIZE, 16> offsets = CompactOffsets<SIZE, PPOS_SIZE, 16>();
+public:
+  static constexpr int MAX_BROWNS() { return 16; }
+  static constexpr uint64_t offset(int k) {
+    return offsets.v[k / 2];
+  }
+  static constexpr uint64_t size() {
+    return offset(MAX_BROWNS() + 2);
+  }
+  static bool reachable(Board<SIZE> const& b) {
+    int k = b.browns_size();
+    return k % 2 == 0 && k <= MAX_BROWNS();
+  }
+  static uint64_t to_index(Board<SIZE> const& b) {
+    uint64_t i = b.to_index();
+    uint64_t browns = i & ((1ull << (SIZE - 1)) - 1);
+    int k = popcnt(browns);
+    return offset(k) + (i >> (SIZE - 1)) * combination.binomial(SIZE - 1, k) + combination.rank(browns);
+  }
+  static Board<SIZE> from_index(uint64_t i, int turn) {
+    int k = 0;
+    while (offset(k + 2) <= i) k += 2;
+    uint64_t c = combination.binomial(SIZE - 1, k);
+    uint64_t ppos = (i - offset(k)) / c;
+    uint64_t browns = combination.unrank((i - offset(k)) % c, k);
+    return Board<SIZE>::from_index((ppos << (SIZE - 1)) | browns, turn);
+  }
+  /*
+   * call f(i, b) for the positions b with index i in [start, end)
+   * (faster than from_index for each i)
+   */
+  template<typename F>
+  static void for_range(uint64_t start, uint64_t end, int turn, F f) {
+    if (start >= end) return;
+    Board<SIZE> b = from_index(start, turn);
+    int k = b.browns_size();
+    uint64_t c = combination.binomial(SIZE - 1, k);
+    uint64_t r = (start - offset(k)) % c;
+    uint64_t ppos = (start - offset(k)) / c;
+    uint64_t browns = b.to_index() & ((1ull << (SIZE - 1)) - 1);
+    for (uint64_t i = start; i < end; i++) {
+      f(i, Board<SIZE>::from_index((ppos << (SIZE - 1)) | browns, turn));
+      if (++r < c) {
+	browns = Combination::next(browns);
+	continue;
+      }
+      r = 0;
+      if (++ppos == PPOS_SIZE) {
+	ppos = 0;
+	k += 2;
+	c = combination.binomial(SIZE - 1, k);
+      }
+      browns = (1ull << k) - 1;
+    }
+  }
+};
+
+/*
+ * permutation of the bits of a 32 bit word by a table lookup for each byte
+ */
+class BitPermutation {
+  uint32_t t[4][256];
+public:
+  BitPermutation() :t() {}
+  /*
+   * bit `from' of the argument goes to bit `to' of the result
+   */
+  void set(int from, int to) {
+    for (int x = 0; x < 256; x++)
+      if ((x >> (from % 8)) & 1) t[from / 8][x] |= (1u << to);
+  }
+  uint32_t operator()(uint32_t x) const {
+    return t[0][x & 255] | t[1][(x >> 8) & 255] | t[2][(x >> 16) & 255] | t[3][x >> 24];
+  }
+};
+
+/*
+ * index of the positions of SIZE = 25 up to the symmetries of the square.
+ * a position is moved by one of the 8 symmetries so that ppos becomes the
+ * smallest point of its orbit (0, 1, 2, 5, 6 or 10), and then it is reduced
+ * by the reflection which fixes that point
+ * (flip() for 0, 1 and 2, the diagonal for 6 and 10, none for 5).
+ * the center 2 is reduced by flip() only.
+ * the points other than ppos are f fixed points and p pairs (l, h) of
+ * the reflection. the browns are packed into L | H << p | (fixed) << 2p,
+ * where L, H are the browns on the l's and h's. the reflection swaps L and H,
+ * so the stored position has L >= H and is numbered by
+ *   offset(ppos) + ((L * (L + 1) / 2 + H) << f) + (fixed)
+ * pack[ppos] moves the browns of any position to the packed browns of its
+ * class at once.
+ */
+class D4Index {
+  struct PposClass {
+    int pos;
+    int f;  // -1 if there is no reflection
+    int p;
+    uint64_t offset;
+    BitPermutation scatter;
+  };
+  static constexpr int SIZE = 25;
+  int trans_pos[8][SIZE];
+  BitPermutation trans[8];
+  BitPermutation pack[SIZE];
+  int class_of[SIZE];
+  PposClass classes[6];
+  uint64_t size_;
+
+  Board<SIZE> apply(int t, Board<SIZE> const& b) const {
+    uint64_t bpos = b.ppos();
+    uint64_t browns = b.v & ((1ull << SIZE) - 1) & ~(1ull << bpos);
+    uint64_t bpos1 = trans_pos[t][bpos];
+    return Board<SIZE>((bpos1 << SIZE) | (b.turn() << bpos1) | trans[t](browns));
+  }
+  Board<SIZE> unpack(PposClass const& cl, uint64_t x, int turn) const {
+    uint64_t bpos = cl.pos;
+    return Board<SIZE>((bpos << SIZE) | (static_cast<uint64_t>(turn) << bpos) | cl.scatter(x));
+  }
+  /*
+   * the class and the packed browns of the stored position for b
+   */
+  uint64_t canonical_packed(Board<SIZE> const& b, PposClass const*& cl) const {
+    int bpos = b.ppos();
+    uint64_t x = pack[bpos](b.v & ((1ull << SIZE) - 1) & ~(1ull << bpos));
+    cl = &classes[class_of[bpos]];
+    if (cl->f < 0) return x;
+    uint64_t mask = (1ull << cl->p) - 1;
+    uint64_t l = x & mask, h = (x >> cl->p) & mask;
+    if (l >= h) return x;
+    return h | (l << cl->p) | (x & ~((mask << cl->p) | mask));
+  }
+public:
+  static constexpr int CLASS_SIZE() { return 6; }
+  static constexpr int CENTER() { return 2; }
+  D4Index() {
+    // t = 4 * j + i : flip() j times after rotate90() i times
+    for (int pos = 0; pos < SIZE; pos++) {
+      int q = pos;
+      for (int i = 0; i < 4; i++) {
+	trans_pos[i][pos] = q;
+	trans_pos[4 + i][pos] = Board<SIZE>::flip_pos(q);
+	q = Board<SIZE>::rotate90_pos(q);
+      }
+    }
+    for (int t = 0; t < 8; t++)
+      for (int pos = 0; pos < SIZE; pos++)
+	trans[t].set(pos, trans_pos[t][pos]);
+    // bits[c][q] : the bit of the point q in the packed browns of the class c
+    int bits[SIZE][SIZE];
+    int class_size = 0;
+    uint64_t offset = 0;
+    for (int pos = 0; pos < SIZE; pos++) {
+      int c = pos;
+      for (int t = 0; t < 8; t++) c = std::min(c, trans_pos[t][pos]);
+      if (c != pos) continue;
+      int* bit = bits[pos];
+      PposClass& cl = classes[class_size++];
+      cl.pos = pos;
+      cl.offset = offset;
+      int sigma = 0;
+      for (int t = 1; t < 8; t++)
+	if (trans_pos[t][pos] == pos && (pos != CENTER() || t == 4)) sigma = t;
+      if (sigma == 0) {
+	cl.f = -1;
+	for (int q = 0; q < SIZE; q++) bit[q] = (q < pos ? q : q - 1);
+	offset += 1ull << (SIZE - 1);
+      } else {
+	cl.f = 0;
+	for (int q = 0; q < SIZE; q++)
+	  if (q != pos && trans_pos[sigma][q] == q) cl.f++;
+	cl.p = (SIZE - 1 - cl.f) / 2;
+	int f = 0, p = 0;
+	for (int h = 0; h < SIZE; h++) {
+	  int l = trans_pos[sigma][h];
+	  if (h == pos) continue;
+	  if (l == h) {
+	    bit[h] = 2 * cl.p + f++;
+	  } else if (l < h) {
+	    bit[l] = p;
+	    bit[h] = cl.p + p;
+	    p++;
+	  }
+	}
+	offset += ((1ull << cl.p) * ((1ull << cl.p) + 1) / 2) << cl.f;
+      }
+      for (int q = 0; q < SIZE; q++)
+	if (q != pos) cl.scatter.set(bit[q], q);
+    }
+    assert(class_size == CLASS_SIZE());
+    size_ = offset;
+    for (int pos = 0; pos < SIZE; pos++) {
+      int t = 0;
+      for (int t1 = 1; t1 < 8; t1++)
+	if (trans_pos[t1][pos] < trans_pos[t][pos]) t = t1;
+      int c = trans_pos[t][pos];
+      class_of[pos] = std::find_if(classes, classes + CLASS_SIZE(), [&](PposClass const& cl) { return cl.pos == c; }) - classes;
+      for (int q = 0; q < SIZE; q++)
+	if (q != pos) pack[pos].set(q, bits[c][trans_pos[t][q]]);
+    }
+  }
+  uint64_t size() const {
+    return size_;
+  }
+  /*
+   * the index of the stored position which has the same value as b
+   */
+  uint64_t canonical_index(Board<SIZE> const& b) const {
+    PposClass const* cl;
+    uint64_t x = canonical_packed(b, cl);
+    if (cl->f < 0) return cl->offset + x;
+    uint64_t l = x & ((1ull << cl->p) - 1), h = (x >> cl->p) & ((1ull << cl->p) - 1);
+    return cl->offset + (((l * (l + 1) / 2 + h) << cl->f) | (x >> (2 * cl->p)));
+  }
+  /*
+   * the stored position which has the same value as b
+   */
+  Board<SIZE> canonical(Board<SIZE> const& b) const {
+    PposClass const* cl;
+    uint64_t x = canonical_packed(b, cl);
+    return unpack(*cl, x, b.turn());
+  }
+  /*
+   * b must be canonical
+   */
+  uint64_t to_index(Board<SIZE> const& b) const {
+    return canonical_index(b);
+  }
+  /*
+   * call f(n) for the different positions n with canonical(n) == b
+   */
+  template<typename F>
+  void for_images(Board<SIZE> const& b, F f) const {
+    uint64_t seen[8];
+    int seen_size = 0;
+    int bpos = b.ppos();
+    for (int t = 0; t < 8; t++) {
+      if (bpos == CENTER() && t != 0 && t != 4) continue;
+      Board<SIZE> n = apply(t, b);
+      if (std::find(seen, seen + seen_size, n.v) != seen + seen_size) continue;
+      seen[seen_size++] = n.v;
+      f(n);
+    }
+  }
+  Board<SIZE> from_index(uint64_t i, int turn) const {
+    int c = CLASS_SIZE() - 1;
+    while (classes[c].offset > i) c--;
+    PposClass const& cl = classes[c];
+    uint64_t r = i - cl.offset;
+    if (cl.f < 0) return unpack(cl, r, turn);
+    uint64_t t = r >> cl.f;
+    uint64_t l = (static_cast<uint64_t>(sqrt(8.0 * t + 1)) - 1) / 2;
+    while (l * (l + 1) / 2 > t) l--;
+    while ((l + 1) * (l + 2) / 2 <= t) l++;
+    uint64_t h = t - l * (l + 1) / 2;
+    return unpack(cl, l | (h << cl.p) | ((r & ((1ull << cl.f) - 1)) << (2 * cl.p)), turn);
+  }
+  /*
+   * call f(i, b) for the positions b with index i in [start, end)
+   * (faster than from_index for each i)
+   */
+  template<typename F>
+  void for_range(uint64_t start, uint64_t end, int turn, F f) const {
+    uint64_t i = start;
+    while (i < end) {
+      int c = CLASS_SIZE() - 1;
+      while (classes[c].offset > i) c--;
+      PposClass const& cl = classes[c];
+      uint64_t class_end = std::min(end, c + 1 < CLASS_SIZE() ? classes[c + 1].offset : size_);
+      if (cl.f < 0) {
+	for (; i < class_end; i++)
+	  f(i, unpack(cl, i - cl.offset, turn));
+	continue;
+      }
+      uint64_t r = i - cl.offset, t = r >> cl.f;
+      uint64_t fixed = r & ((1ull << cl.f) - 1);
+      uint64_t l = (static_cast<uint64_t>(sqrt(8.0 * t + 1)) - 1) / 2;
+      while (l * (l + 1) / 2 > t) l--;
+      while ((l + 1) * (l + 2) / 2 <= t) l++;
+      uint64_t h = t - l * (l + 1) / 2;
+      for (; i < class_end; i++) {
+	f(i, unpack(cl, l | (h << cl.p) | (fixed << (2 * cl.p)), turn));
+	if (++fixed < (1ull << cl.f)) continue;
+	fixed = 0;
+	if (h < l) {
+	  h++;
+	} else {
+	  l++;
+	  h = 0;
+	}
+      }
+    }
+  }
+};
 
+static D4Index d4index;
 
 template<int SIZE>
 static constexpr bool operator==(Board<SIZE> const& x, Board<SIZE> const& y) {
@@ -0,0 +1,55 @@
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+/*
+ * the size of the last level cache, and the width of the tiles of a
+ * sweep which keep the rows it touches in that cache.
+ * a sweep over `rows' rows of `row_bits' bits each (one bit per position)
+ * goes over tiles of `width' columns in all rows at a time, and touches
+ * about `bits_per_column' bits of the tables for a column of all rows.
+ */
+class CacheTiles {
+  static size_t parse_size(std::string const& s) {
+    size_t pos = 0;
+    size_t v = std::stoull(s, &pos);
+    if (pos < s.size() && (s[pos] == 'K' || s[pos] == 'k')) v <<= 10;
+    else if (pos < s.size() && s[pos] == 'M') v <<= 20;
+    return v;
+  }
+public:
+  /*
+   * the size of the largest cache of cpu 0 [bytes] (0 if it is not known)
+   */
+  static size_t llc_bytes() {
+    size_t r = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3 > 0) r = l3;
+#endif
+    if (r > 0) return r;
+    for (int i = 0; ; i++) {
+      std::ifstream f("/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/size");
+      std::string s;
+      if (!(f >> s)) return r;
+      try {
+	r = std::max(r, parse_size(s));
+      } catch (std::exception const&) {
+      }
+    }
+  }
+  /*
+   * the widest tile (a power of two, from min_width to row_bits) of which
+   * the n_workers tiles being swept at once take at most half of the
+   * cache of llc bytes, with at least n_workers tiles in a row
+   */
+  static uint64_t width(size_t llc, uint64_t bits_per_column, uint64_t row_bits, int n_workers, uint64_t min_width) {
+    uint64_t w = min_width;
+    while (w * 2 <= row_bits && w * 2 * n_workers <= row_bits &&
+	   w * 2 * bits_per_column * n_workers <= llc * 8 / 2)
+      w *= 2;
+    return w;
+  }
+};
@@ -0,0 +1,122 @@
+#include <zlib.h>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t x) {
+  while (x >= 0x80) {
+    out.push_back(static_cast<uint8_t>(x | 0x80));
+    x >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(x));
+}
+
+inline uint64_t get_varint(uint8_t const* p, size_t& pos) {
+  uint64_t x = 0;
+  for (int shift = 0; ; shift += 7) {
+    uint8_t b = p[pos++];
+    x |= static_cast<uint64_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) return x;
+  }
+}
+
+/*
+ * the indices set in a step, in increasing order.
+ * a file is a sequence of blocks of at most BLOCK_SIZE() indices :
+ *   uint64_t first index
+ *   uint32_t number of indices
+ *   uint32_t size of the rest
+ *   zlib compressed varints of (index - previous index - 1)
+ * the file is written as <fname>.tmp and renamed by close().
+ */
+class DeltaWriter {
+  std::string fname;
+  std::ofstream ofs;
+  std::vector<uint8_t> raw, compressed;
+  uint64_t first, last;
+  uint32_t n;
+  uint64_t total;
+  void flush() {
+    if (n == 0) return;
+    uLongf zsize = compressBound(raw.size());
+    compressed.resize(zsize);
+    if (compress2(&compressed[0], &zsize, raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK)
+      throw std::runtime_error("compress error in " + fname);
+    uint32_t size32 = zsize;
+    ofs.write((char const*)&first, sizeof(first));
+    ofs.write((char const*)&n, sizeof(n));
+    ofs.write((char const*)&size32, sizeof(size32));
+    ofs.write((char const*)&compressed[0], zsize);
+    raw.clear();
+    n = 0;
+  }
+public:
+  static constexpr uint32_t BLOCK_SIZE() { return 0x10000; }
+  explicit DeltaWriter(std::string const& fname_)
+    :fname(fname_), ofs(fname_ + ".tmp", std::ios::binary|std::ios::trunc), first(0), last(0), n(0), total(0) {}
+  void put(uint64_t i) {
+    if (n == 0)
+      first = i;
+    else
+      put_varint(raw, i - last - 1);
+    last = i;
+    total++;
+    if (++n == BLOCK_SIZE()) flush();
+  }
+  uint64_t size() const {
+    return total;
+  }
+  void close() {
+    flush();
+    ofs.close();
+    if (!ofs) throw std::runtime_error("cannot write " + fname + ".tmp");
+    if (std::rename((fname + ".tmp").c_str(), fname.c_str()) != 0)
+      throw std::runtime_error("cannot rename " + fname + ".tmp");
+  }
+};
+
+class DeltaReader {
+  std::ifstream ifs;
+  std::vector<uint8_t> raw, compressed;
+  size_t pos;
+  uint32_t left;
+  uint64_t v;
+  bool read_block() {
+    uint64_t first;
+    uint32_t n, zsize;
+    if (!ifs.read((char *)&first, sizeof(first))) return false;
+    ifs.read((char *)&n, sizeof(n));
+    ifs.read((char *)&zsize, sizeof(zsize));
+    compressed.resize(zsize);
+    ifs.read((char *)&compressed[0], zsize);
+    raw.resize(n * 10ull + 1);
+    uLongf size = raw.size();
+    if (!ifs || uncompress(&raw[0], &size, &compressed[0], zsize) != Z_OK)
+      throw std::runtime_error("broken delta file");
+    pos = 0;
+    left = n - 1;
+    v = first;
+    return true;
+  }
+public:
+  explicit DeltaReader(std::string const& fname) :ifs(fname, std::ios::binary), pos(0), left(0), v(0) {
+    if (!ifs.is_open()) throw std::runtime_error("cannot open " + fname);
+  }
+  /*
+   * the next index of the file. returns false at the end.
+   */
+  bool next(uint64_t& i) {
+    if (left == 0) {
+      if (!read_block()) return false;
+      i = v;
+      return true;
+    }
+    v += get_varint(&raw[0], pos) + 1;
+    left--;
+    i = v;
+    return true;
+  }
+};
@@ -0,0 +1,91 @@
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+
+/*
+ * the files by which the processes of a partitioned solver agree on the
+ * end of each step, in a directory which all of them can read (a local
+ * one, or one on a shared file system)
+ *  changed_<step>.P<part> : the positions set by the part in the step
+ *  go_<step> : the sum of them over all parts, written by the coordinator
+ *   when all of them are there
+ * each file is written to a temporary name and renamed, so that it is
+ * complete when it is seen. wait_*() poll the directory and call `check'
+ * between the polls (which throws to give up).
+ */
+class ExchangeDir {
+  std::string dir;
+  static constexpr std::chrono::milliseconds POLL() { return std::chrono::milliseconds(2); }
+  void put(std::string const& name, uint64_t v) const {
+    std::string fname = path(name);
+    {
+      std::ofstream f(fname + ".tmp", std::ios::trunc);
+      f << v << std::endl;
+      if (!f) throw std::runtime_error("cannot write " + fname + ".tmp");
+    }
+    if (std::rename((fname + ".tmp").c_str(), fname.c_str()) != 0)
+      throw std::runtime_error("cannot rename " + fname + ".tmp");
+  }
+  bool get(std::string const& name, uint64_t& v) const {
+    std::ifstream f(path(name));
+    return static_cast<bool>(f >> v);
+  }
+  static std::string changed_name(int step, int part) {
+    return "changed_" + std::to_string(step) + ".P" + std::to_string(part);
+  }
+  static std::string go_name(int step) {
+    return "go_" + std::to_string(step);
+  }
+public:
+  explicit ExchangeDir(std::string const& dir_) :dir(dir_) {
+    std::filesystem::create_directories(dir);
+  }
+  std::string path(std::string const& name) const {
+    return dir + "/" + name;
+  }
+  /*
+   * remove the files of an earlier run
+   */
+  void clear() const {
+    for (auto const& e : std::filesystem::directory_iterator(dir)) {
+      std::string name = e.path().filename().string();
+      if (name.compare(0, 8, "changed_") == 0 || name.compare(0, 3, "go_") == 0)
+	std::filesystem::remove(e.path());
+    }
+  }
+  void put_changed(int step, int part, uint64_t changed) const {
+    put(changed_name(step, part), changed);
+  }
+  /*
+   * the sum of the changes of the parts 0 .. n_parts - 1 in the step
+   */
+  uint64_t wait_changed(int step, int n_parts, std::function<void()> const& check) const {
+    uint64_t sum = 0;
+    for (int part = 0; part < n_parts; part++) {
+      uint64_t v;
+      while (!get(changed_name(step, part), v)) {
+	check();
+	std::this_thread::sleep_for(POLL());
+      }
+      sum += v;
+    }
+    return sum;
+  }
+  void put_go(int step, uint64_t total) const {
+    put(go_name(step), total);
+  }
+  uint64_t wait_go(int step, std::function<void()> const& check) const {
+    uint64_t v;
+    while (!get(go_name(step), v)) {
+      check();
+      std::this_thread::sleep_for(POLL());
+    }
+    return v;
+  }
+};
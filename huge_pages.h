@@ -0,0 +1,131 @@
+#include <sys/mman.h>
+#include <atomic>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <new>
+#include <utility>
+#include <cstdlib>
+#include <cstdint>
+
+/*
+ * the memory of the solver tables.
+ * a block of at least HUGE_SIZE() bytes is mapped by mmap, on the explicit
+ * huge pages of the kernel (MAP_HUGETLB) if there are enough free ones,
+ * otherwise on normal pages marked for transparent huge pages
+ * (MADV_HUGEPAGE). the pages are zero until they are written, so a new
+ * table costs nothing until it is used and the pages which are only read
+ * share the zero page of the kernel. smaller blocks come from calloc.
+ * bytes(kind) is the size of the blocks of each kind mapped so far.
+ */
+class HugePages {
+public:
+  enum Kind { SMALL, TRANSPARENT, EXPLICIT, N_KINDS };
+  static constexpr size_t HUGE_SIZE() { return 1 << 21; }
+  static std::atomic<uint64_t>& bytes(Kind kind) {
+    static std::atomic<uint64_t> b[N_KINDS];
+    return b[kind];
+  }
+  /*
+   * false : map every block on normal pages without MADV_HUGEPAGE
+   */
+  static bool& enabled() {
+    static bool e = true;
+    return e;
+  }
+  /*
+   * the mode of transparent huge pages (always, madvise or never)
+   */
+  static std::string thp_mode() {
+    std::ifstream f("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string s;
+    std::getline(f, s);
+    size_t b = s.find('['), e = s.find(']');
+    return (b == std::string::npos || e == std::string::npos ? "never" : s.substr(b + 1, e - b - 1));
+  }
+  /*
+   * the bytes of this process on transparent huge pages now
+   */
+  static uint64_t anon_huge_bytes() {
+    std::ifstream f("/proc/self/smaps_rollup");
+    for (std::string s; std::getline(f, s); )
+      if (s.compare(0, 14, "AnonHugePages:") == 0) return std::stoull(s.substr(14)) * 1024;
+    return 0;
+  }
+  static size_t round_up(size_t n) {
+    return (n + HUGE_SIZE() - 1) & ~(HUGE_SIZE() - 1);
+  }
+  static void *map(size_t n) {
+    if (n < HUGE_SIZE()) {
+      void *p = std::calloc(n, 1);
+      if (p == nullptr) throw std::bad_alloc();
+      return p;
+    }
+    size_t len = round_up(n);
+    if (enabled()) {
+      void *p = mmap(nullptr, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED) {
+	bytes(EXPLICIT) += len;
+	return p;
+      }
+    }
+    // align the block to a huge page, so that all of it can be on huge pages
+    size_t mapped = len + (enabled() ? HUGE_SIZE() : 0);
+    uint8_t *q = static_cast<uint8_t *>(mmap(nullptr, mapped, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+    if (q == MAP_FAILED) throw std::bad_alloc();
+    if (!enabled()) {
+      bytes(SMALL) += len;
+      return q;
+    }
+    uint8_t *p = reinterpret_cast<uint8_t *>(round_up(reinterpret_cast<uintptr_t>(q)));
+    if (p != q) munmap(q, p - q);
+    if (p + len != q + mapped) munmap(p + len, q + mapped - (p + len));
+    bool thp = (madvise(p, len, MADV_HUGEPAGE) == 0 && thp_mode() != "never");
+    bytes(thp ? TRANSPARENT : SMALL) += len;
+    return p;
+  }
+  static void unmap(void *p, size_t n) {
+    if (n < HUGE_SIZE()) {
+      std::free(p);
+      return;
+    }
+    munmap(p, round_up(n));
+  }
+  /*
+   * which pages the tables are on
+   */
+  static void report(std::ostream &os) {
+    os << "pages : explicit " << (HUGE_SIZE() >> 10) << "kB=" << bytes(EXPLICIT)
+       << ", transparent huge (" << thp_mode() << ")=" << bytes(TRANSPARENT)
+       << ", 4kB=" << bytes(SMALL)
+       << ", AnonHugePages=" << anon_huge_bytes() << " bytes" << std::endl;
+  }
+};
+
+/*
+ * the allocator of std::vector for the tables (see HugePages).
+ * construct() without an argument leaves the memory as it is, so that
+ * std::vector<T, HugePageAllocator<T>>(n) is zero without writing it.
+ */
+template<typename T>
+struct HugePageAllocator {
+  using value_type = T;
+  HugePageAllocator() = default;
+  template<typename U>
+  HugePageAllocator(HugePageAllocator<U> const&) {}
+  T *allocate(size_t n) {
+    return static_cast<T *>(HugePages::map(n * sizeof(T)));
+  }
+  void deallocate(T *p, size_t n) {
+    HugePages::unmap(p, n * sizeof(T));
+  }
+  template<typename U, typename... Args>
+  void construct(U *p, Args&&... args) {
+    if constexpr (sizeof...(Args) > 0)
+      ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+  template<typename U>
+  bool operator==(HugePageAllocator<U> const&) const { return true; }
+  template<typename U>
+  bool operator!=(HugePageAllocator<U> const&) const { return false; }
+};
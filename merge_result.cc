@@ -1,4 +1,5 @@
 #include "board.h"
+#include "delta_file.h"
 #include <fstream>
 #include <chrono>
 #include <thread>
@@ -76,6 +77,16 @@ class Merger {
   static constexpr size_t table_size() {
     return h_table_size() * 2;
   }
+  static constexpr size_t ppos_size() {
+    if (NO_SYMMETRY())
+      return SIZE;
+    else
+      return Board<SIZE>::HSIZE();
+  }
+  static uint64_t layer_size(int k) {
+    return ppos_size() * combination.binomial(SIZE - 1, k);
+  }
+  typedef CompactIndex<SIZE, ppos_size()> Compact;
 
 /*
   0 - unknown
@@ -106,6 +117,101 @@ public:
     }
   }
 
+  std::string file_name(int step, int k) {
+    std::string color = (step % 2 == 1 ? "black" : "brown");
+    return color + "_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_L" + std::to_string(k) + "_" + std::to_string(step) + ".bin";
+  }
+
+  std::string compact_file_name(int step, std::string const& infix = "_C_", std::string const& ext = ".bin") {
+    std::string color = (step % 2 == 1 ? "black" : "brown");
+    return color + "_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + infix + std::to_string(step) + ext;
+  }
+
+  /*
+   * merge the delta files black/brown_<SIZE>_<capture_type><infix><step>.delta
+   * (see DeltaWriter) into `fname' of `size' bytes. the value of the index i
+   * of a turn is written at pos(turn, i), which must increase with i.
+   * every decided position is in exactly one delta, so each window of the
+   * file is filled from the deltas in turn, and the windows without any
+   * decided position are left as holes of the file (which read as 0).
+   */
+  template<typename F>
+  void merge_deltas(std::string const& infix, uint64_t size, std::string const& fname, F pos) {
+    static constexpr uint64_t WINDOW = 1ull << 26;
+    std::vector<DeltaReader> streams;
+    std::vector<int> steps;
+    for (int step = 1; step < 256; step++) {
+      std::ifstream ifs(compact_file_name(step, infix, ".delta"));
+      if (!ifs.is_open()) break;
+      streams.emplace_back(compact_file_name(step, infix, ".delta"));
+      steps.push_back(step);
+    }
+    // the position of the next index of each delta (size at the end)
+    std::vector<uint64_t> next(streams.size());
+    auto advance = [&](size_t j) {
+      uint64_t i;
+      next[j] = (streams[j].next(i) ? pos((steps[j] - 1) % 2, i) : size);
+    };
+    for (size_t j = 0; j < streams.size(); j++) advance(j);
+    std::ofstream ofs(fname, std::ios::binary|std::ios::trunc);
+    std::vector<char> buf(WINDOW, 0);
+    uint64_t decided = 0, written = 0;
+    for (uint64_t w = 0; w < size; w += WINDOW) {
+      uint64_t end = std::min(w + WINDOW, size);
+      bool empty = true;
+      for (size_t j = 0; j < streams.size(); j++) {
+	for (; next[j] < end; advance(j)) {
+	  buf[next[j] - w] = steps[j];
+	  decided++;
+	  empty = false;
+	}
+      }
+      if (empty) continue;
+      ofs.seekp(w, std::ios_base::beg);
+      ofs.write(&buf[0], end - w);
+      written = end;
+      std::fill(buf.begin(), buf.end(), 0);
+      std::lock_guard<std::mutex> l_(io_lock);
+      std::cerr << "v=" << w << ", decided=" << decided << std::endl;
+    }
+    if (written < size) {
+      ofs.seekp(size - 1, std::ios_base::beg);
+      ofs.put(0);
+    }
+    ofs.close();
+    if (!ofs) throw std::runtime_error("cannot write " + fname);
+  }
+
+  /*
+   * merge the step files black/brown_<SIZE>_<capture_type><infix><step>.bin
+   * of `size' positions into `fname' (black positions, then brown positions)
+   */
+  void merge_steps(std::string const& infix, uint64_t size, std::string const& fname) {
+    std::ofstream ofs(fname, std::ios::binary|std::ios::trunc);
+    for (int turn = 0; turn < 2; turn++) {
+      std::vector<BitReader> streams;
+      std::vector<int> steps;
+      for (int step = 1 + turn; step < 256; step += 2) {
+	std::ifstream ifs(compact_file_name(step, infix));
+	if (!ifs.is_open()) break;
+	streams.emplace_back(BitReader(compact_file_name(step, infix)));
+	steps.push_back(step);
+      }
+      for (uint64_t i = 0; i < size; i++) {
+	char r = 0;
+	for (size_t j = 0; j < streams.size(); j++) {
+	  int v = streams[j].read();
+	  if (r == 0 && v > 0) r = steps[j];
+	}
+	ofs << r;
+      }
+    }
+  }
+
+  std::string layer_file_name(int k) {
+    return "count_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_L" + std::to_string(k) + ".bin";
+  }
+
   bool check_step(int step) {
     std::ifstream ifs(file_name(step));
     return ifs.is_open();
@@ -134,7 +240,141 @@ public:
     return r;
   }
   
-  void merge() {
+  /*
+   * merge the snapshots of layer k (see LayeredTableMaker in solve.cc)
+   * into count_<SIZE>_<capture_type>_L<k>.bin, which has the values of
+   * the black positions of the layer followed by those of the brown ones.
+   * a layer has no snapshot for the steps in which it did not change.
+   */
+  void merge_layer(int k) {
+    std::cerr << "start mearging layer=" << k << std::endl;
+    std::ofstream ofs(layer_file_name(k), std::ios::binary|std::ios::trunc);
+    for (int turn = 0; turn < 2; turn++) {
+      std::vector<BitReader> streams;
+      std::vector<int> steps;
+      for (int step = 1 + turn; step < 256; step += 2) {
+	std::ifstream ifs(file_name(step, k));
+	if (!ifs.is_open()) continue;
+	streams.emplace_back(BitReader(file_name(step, k)));
+	steps.push_back(step);
+      }
+      for (uint64_t i = 0; i < layer_size(k); i++) {
+	char r = 0;
+	for (size_t j = 0; j < streams.size(); j++) {
+	  int v = streams[j].read();
+	  if (r == 0 && v > 0) r = steps[j];
+	}
+	ofs << r;
+      }
+    }
+  }
+
+  /*
+   * merge the output of `solve --layered'
+   */
+  void merge_layered() {
+    std::cerr << "start mearging layers SIZE=" << SIZE << ", capture_type=" << capture_type << std::endl;
+    std::vector<std::ifstream> layers[2];
+    for (int k = 0; k < SIZE; k++) {
+      merge_layer(k);
+      for (int turn = 0; turn < 2; turn++) {
+	layers[turn].emplace_back(layer_file_name(k), std::ios::binary);
+	layers[turn][k].seekg(turn * layer_size(k), std::ios_base::beg);
+      }
+    }
+    std::ofstream ofs(out_file_name(), std::ios::binary|std::ios::trunc);
+    for (uint64_t v = 0; v < table_size(); v++ ) {
+      if (v % 10000000 == 0) {
+	std::lock_guard<std::mutex> l_(io_lock);
+	std::cerr << "step=" << v << std::endl;
+      }
+      Board<SIZE> b(v);
+      ofs.put(layers[b.turn()][b.browns_size()].get());
+    }
+  }
+
+  /*
+   * merge the output of `solve --compact' into count_<SIZE>_<capture_type>_C.bin
+   * (the values of the black positions in the order of CompactIndex followed
+   * by those of the brown ones), and expand it to count_<SIZE>_<capture_type>.bin.
+   * the positions which cannot appear in a game have the value 0.
+   */
+  void merge_compact(bool delta = false) {
+    std::cerr << "start mearging compact SIZE=" << SIZE << ", capture_type=" << capture_type << ", delta=" << delta << std::endl;
+    std::string compact_name = "count_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_C.bin";
+    if (delta)
+      merge_deltas("_C_", Compact::size() * 2, compact_name, [](int turn, uint64_t i) {
+	  return turn * Compact::size() + i;
+	});
+    else
+      merge_steps("_C_", Compact::size(), compact_name);
+    // the positions with k browns are in the same order in both files
+    std::vector<std::ifstream> layers[2];
+    for (int k = 0; k <= Compact::MAX_BROWNS(); k += 2) {
+      for (int turn = 0; turn < 2; turn++) {
+	layers[turn].emplace_back(compact_name, std::ios::binary);
+	layers[turn].back().seekg(turn * Compact::size() + Compact::offset(k), std::ios_base::beg);
+      }
+    }
+    std::ofstream ofs(out_file_name(), std::ios::binary|std::ios::trunc);
+    for (uint64_t v = 0; v < table_size(); v++ ) {
+      if (v % 10000000 == 0) {
+	std::lock_guard<std::mutex> l_(io_lock);
+	std::cerr << "step=" << v << std::endl;
+      }
+      Board<SIZE> b(v);
+      if (Compact::reachable(b))
+	ofs.put(layers[b.turn()][b.browns_size() / 2].get());
+      else
+	ofs.put(0);
+    }
+  }
+
+  /*
+   * merge the output of `solve --d4' into count_25_<capture_type>_D4.bin
+   * (in the order of D4Index) and expand it to count_25_<capture_type>.bin
+   */
+  void merge_d4(bool delta = false) {
+    std::cerr << "start mearging d4 SIZE=" << SIZE << ", capture_type=" << capture_type << ", delta=" << delta << std::endl;
+    std::string d4_name = "count_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_D4.bin";
+    if (delta)
+      merge_deltas("_D4_", d4index.size() * 2, d4_name, [](int turn, uint64_t i) {
+	  return turn * d4index.size() + i;
+	});
+    else
+      merge_steps("_D4_", d4index.size(), d4_name);
+    std::vector<char> values(d4index.size() * 2);
+    {
+      std::ifstream ifs(d4_name, std::ios::binary);
+      ifs.read(&values[0], values.size());
+    }
+    std::ofstream ofs(out_file_name(), std::ios::binary|std::ios::trunc);
+    for (uint64_t v = 0; v < table_size(); v++ ) {
+      if (v % 10000000 == 0) {
+	std::lock_guard<std::mutex> l_(io_lock);
+	std::cerr << "step=" << v << std::endl;
+      }
+      Board<25> b(v);
+      ofs.put(values[b.turn() * d4index.size() + d4index.to_index(d4index.canonical(b))]);
+    }
+  }
+
+  /*
+   * merge the output of `solve --delta' directly into count_<SIZE>_<capture_type>.bin
+   * (Board::to_index() keeps the order of the positions of a turn)
+   */
+  void merge_delta() {
+    std::cerr << "start mearging deltas SIZE=" << SIZE << ", capture_type=" << capture_type << std::endl;
+    merge_deltas("_", table_size(), out_file_name(), [](int turn, uint64_t i) {
+	return Board<SIZE>::from_index(i, turn).v;
+      });
+  }
+
+  void merge(bool delta = false) {
+    if (delta) {
+      merge_delta();
+      return;
+    }
     // std::string prefix="/mnt/sda1/ktanaka/";
     std::cerr << "start mearging SIZE=" << SIZE << ", capture_type=" << capture_type << std::endl;
     std::ofstream ofs(out_file_name(), std::ios::binary|std::ios::trunc);
@@ -159,9 +399,58 @@ public:
   }
 };
 
+template<int SIZE>
+bool merge_compact(int capture_type, bool delta) {
+  if (capture_type == 0)
+    Merger<SIZE, 0>().merge_compact(delta);
+  else if (capture_type == 1)
+    Merger<SIZE, 1>().merge_compact(delta);
+  else if (capture_type == 2)
+    Merger<SIZE, 2>().merge_compact(delta);
+  else if (capture_type == 3)
+    Merger<SIZE, 3>().merge_compact(delta);
+  else if (capture_type == 4)
+    Merger<SIZE, 4>().merge_compact(delta);
+  else
+    return false;
+  return true;
+}
+
+bool merge_d4(int capture_type, bool delta) {
+  // the other capture types are not symmetric
+  if (capture_type == 0)
+    Merger<25, 0>().merge_d4(delta);
+  else if (capture_type == 1)
+    Merger<25, 1>().merge_d4(delta);
+  else
+    return false;
+  return true;
+}
+
+template<int SIZE>
+bool merge_layered(int capture_type) {
+  if (capture_type == 0)
+    Merger<SIZE, 0>().merge_layered();
+  else if (capture_type == 1)
+    Merger<SIZE, 1>().merge_layered();
+  else if (capture_type == 2)
+    Merger<SIZE, 2>().merge_layered();
+  else if (capture_type == 3)
+    Merger<SIZE, 3>().merge_layered();
+  else if (capture_type == 4)
+    Merger<SIZE, 4>().merge_layered();
+  else
+    return false;
+  return true;
+}
+
 int main(int ac, char **ag) {
   int board_size;
   int capture_type;
+  bool layered;
+  bool compact;
+  bool d4;
+  bool delta;
   
   po::options_description options("all_options");
   options.add_options()
@@ -171,6 +460,18 @@ int main(int ac, char **ag) {
     ("capture-type,t",
      po::value<int>(&capture_type)->default_value(0),
      "capture type : 0 (ALL), 1(any corner), 2(one corner), 3(1,0), 4(2,0)")
+    ("layered,l",
+     po::bool_switch(&layered)->default_value(false),
+     "merge the output of solve --layered")
+    ("compact,z",
+     po::bool_switch(&compact)->default_value(false),
+     "merge the output of solve --compact")
+    ("d4,d",
+     po::bool_switch(&d4)->default_value(false),
+     "merge the output of solve --d4")
+    ("delta,s",
+     po::bool_switch(&delta)->default_value(false),
+     "merge the output of solve --delta (with --compact or --d4 if they were used)")
     ;
   po::variables_map vm;
   try
@@ -189,17 +490,43 @@ int main(int ac, char **ag) {
     std::cerr << options << std::endl;
     return 0;
   }
+  if (layered) {
+    bool ok = false;
+    if (board_size == 25)
+      ok = merge_layered<25>(capture_type);
+    else if (board_size == 31)
+      ok = merge_layered<31>(capture_type);
+    else if (board_size == 33)
+      ok = merge_layered<33>(capture_type);
+    if (!ok) std::cerr << options << std::endl;
+    return 0;
+  }
+  if (d4) {
+    if (board_size != 25 || !merge_d4(capture_type, delta)) std::cerr << options << std::endl;
+    return 0;
+  }
+  if (compact) {
+    bool ok = false;
+    if (board_size == 25)
+      ok = merge_compact<25>(capture_type, delta);
+    else if (board_size == 31)
+      ok = merge_compact<31>(capture_type, delta);
+    else if (board_size == 33)
+      ok = merge_compact<33>(capture_type, delta);
+    if (!ok) std::cerr << options << std::endl;
+    return 0;
+  }
   if (board_size == 25) {
     if (capture_type == 0)
-      Merger<25, 0>().merge();
+      Merger<25, 0>().merge(delta);
     else if (capture_type == 1)
-      Merger<25, 1>().merge();
+      Merger<25, 1>().merge(delta);
     else if (capture_type == 2)
-      Merger<25, 2>().merge();
+      Merger<25, 2>().merge(delta);
     else if (capture_type == 3)
-      Merger<25, 3>().merge();
+      Merger<25, 3>().merge(delta);
     else if (capture_type == 4)
-      Merger<25, 4>().merge();
+      Merger<25, 4>().merge(delta);
     else {
       std::cerr << options << std::endl;
       return 0;
@@ -207,11 +534,11 @@ int main(int ac, char **ag) {
   }
   else if (board_size == 31) {
     if (capture_type == 0)
-      Merger<31, 0>().merge();
+      Merger<31, 0>().merge(delta);
   }
   else if (board_size == 33) {
     if (capture_type == 0)
-      Merger<33, 0>().merge();
+      Merger<33, 0>().merge(delta);
   }
   else {
     std::cerr << options << std::endl;
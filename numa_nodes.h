@@ -0,0 +1,137 @@
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * the NUMA nodes of the machine (the cpus of each node which this process
+ * may run on), and the placement of memory on them by the mbind and
+ * move_pages system calls.
+ * without /sys/devices/system/node (or without these system calls) all
+ * cpus are on node 0 and the placement does nothing.
+ */
+class NumaNodes {
+  std::vector<std::vector<int>> cpus;
+  static constexpr size_t PAGE_SIZE() { return 4096; }
+
+  static std::vector<int> parse_cpulist(std::string const& s) {
+    std::vector<int> r;
+    std::istringstream is(s);
+    std::string range;
+    while (std::getline(is, range, ',')) {
+      if (range.empty() || range[0] == '\n') continue;
+      size_t dash = range.find('-');
+      int from = std::stoi(range.substr(0, dash));
+      int to = (dash == std::string::npos ? from : std::stoi(range.substr(dash + 1)));
+      for (int c = from; c <= to; c++) r.push_back(c);
+    }
+    return r;
+  }
+  static long mbind(void *addr, size_t len, int mode, std::vector<unsigned long> const& mask) {
+    return syscall(SYS_mbind, addr, len, mode, mask.data(), mask.size() * 64 + 1, MPOL_MF_MOVE);
+  }
+  /*
+   * the whole pages in [addr, addr + len)
+   */
+  static bool page_range(void *addr, size_t len, uintptr_t &start, uintptr_t &end) {
+    start = (reinterpret_cast<uintptr_t>(addr) + PAGE_SIZE() - 1) & ~(PAGE_SIZE() - 1);
+    end = (reinterpret_cast<uintptr_t>(addr) + len) & ~(PAGE_SIZE() - 1);
+    return start < end;
+  }
+  std::vector<unsigned long> node_mask(int node) const {
+    std::vector<unsigned long> mask((size() + 63) / 64, 0);
+    if (node < 0)
+      for (int n = 0; n < size(); n++) mask[n / 64] |= 1ul << (n % 64);
+    else
+      mask[node / 64] |= 1ul << (node % 64);
+    return mask;
+  }
+public:
+  NumaNodes() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool affinity = (sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+    for (int node = 0; ; node++) {
+      std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      if (!f.is_open()) break;
+      std::string s;
+      std::getline(f, s);
+      std::vector<int> node_cpus;
+      for (int c : parse_cpulist(s))
+	if (!affinity || CPU_ISSET(c, &allowed)) node_cpus.push_back(c);
+      cpus.push_back(node_cpus);
+    }
+    if (cpus.empty()) {
+      cpus.emplace_back();
+      for (int c = 0; c < CPU_SETSIZE; c++)
+	if (affinity && CPU_ISSET(c, &allowed)) cpus[0].push_back(c);
+    }
+  }
+  int size() const {
+    return static_cast<int>(cpus.size());
+  }
+  /*
+   * the cpus for n threads spread evenly over the nodes
+   * (thread i is on node i * size() / n)
+   */
+  std::vector<int> thread_cpus(int n) const {
+    std::vector<int> r;
+    std::vector<size_t> used(size(), 0);
+    for (int i = 0; i < n; i++) {
+      int node = static_cast<int>(static_cast<int64_t>(i) * size() / n);
+      // a node without cpus for this process (memory only) lends the cpus of node 0
+      std::vector<int> const& c = (cpus[node].empty() ? cpus[0] : cpus[node]);
+      r.push_back(c.empty() ? -1 : c[used[node]++ % c.size()]);
+    }
+    return r;
+  }
+  int node_of_cpu(int cpu) const {
+    for (int node = 0; node < size(); node++)
+      for (int c : cpus[node])
+	if (c == cpu) return node;
+    return 0;
+  }
+  /*
+   * pin the calling thread to the cpu (does nothing if cpu < 0)
+   */
+  static bool pin(int cpu) {
+    if (cpu < 0) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+  }
+  /*
+   * put the whole pages of [addr, addr + len) on the node
+   * (the pages already touched are moved)
+   */
+  bool bind(void *addr, size_t len, int node) const {
+    uintptr_t start, end;
+    if (size() <= 1 || !page_range(addr, len, start, end)) return false;
+    return mbind(reinterpret_cast<void *>(start), end - start, MPOL_PREFERRED, node_mask(node)) == 0;
+  }
+  /*
+   * spread the whole pages of [addr, addr + len) over all nodes
+   */
+  bool interleave(void *addr, size_t len) const {
+    uintptr_t start, end;
+    if (size() <= 1 || !page_range(addr, len, start, end)) return false;
+    return mbind(reinterpret_cast<void *>(start), end - start, MPOL_INTERLEAVE, node_mask(-1)) == 0;
+  }
+  /*
+   * the node of the page at addr (-1 if it is not in memory or unknown)
+   */
+  int page_node(void const* addr) const {
+    if (size() <= 1) return 0;
+    void *page = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(addr) & ~(PAGE_SIZE() - 1));
+    int status = -1;
+    if (syscall(SYS_move_pages, 0, 1ul, &page, nullptr, &status, 0) != 0) return -1;
+    return status;
+  }
+};
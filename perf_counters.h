@@ -0,0 +1,124 @@
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <cstdint>
+
+/*
+ * the hardware counters of the calling thread (perf_event_open, user
+ * space only), read at the start and the end of a phase of the solver.
+ * a counter which cannot be opened (no PMU in a VM, perf_event_paranoid,
+ * seccomp) is not available, and a phase then has only its wall-clock
+ * time. the counts are scaled by the time the counter was running when
+ * the kernel multiplexes them.
+ */
+class PerfCounters {
+public:
+  enum { CYCLES, INSTRUCTIONS, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, N_EVENTS };
+  static char const* name(int e) {
+    static char const* const names[N_EVENTS] = {"cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses"};
+    return names[e];
+  }
+  struct Values {
+    double v[N_EVENTS] = {};
+    double seconds = 0;
+    Values& operator+=(Values const& o) {
+      for (int e = 0; e < N_EVENTS; e++) v[e] += o.v[e];
+      seconds += o.seconds;
+      return *this;
+    }
+    Values operator-(Values const& o) const {
+      Values r;
+      for (int e = 0; e < N_EVENTS; e++) r.v[e] = v[e] - o.v[e];
+      r.seconds = seconds - o.seconds;
+      return r;
+    }
+  };
+private:
+  int fd[N_EVENTS];
+  int error = 0;
+
+  static perf_event_attr attr(int e) {
+    perf_event_attr a;
+    std::memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.exclude_kernel = 1;
+    a.exclude_hv = 1;
+    a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    auto cache = [](uint64_t cache, uint64_t op, uint64_t result) {
+      return cache | (op << 8) | (result << 16);
+    };
+    switch (e) {
+    case CYCLES:
+      a.type = PERF_TYPE_HARDWARE;
+      a.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case INSTRUCTIONS:
+      a.type = PERF_TYPE_HARDWARE;
+      a.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case LLC_MISSES:
+      a.type = PERF_TYPE_HW_CACHE;
+      a.config = cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+      break;
+    case DTLB_MISSES:
+      a.type = PERF_TYPE_HW_CACHE;
+      a.config = cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+      break;
+    default:
+      a.type = PERF_TYPE_HARDWARE;
+      a.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    }
+    return a;
+  }
+public:
+  PerfCounters() {
+    for (int e = 0; e < N_EVENTS; e++) {
+      perf_event_attr a = attr(e);
+      fd[e] = static_cast<int>(syscall(SYS_perf_event_open, &a, 0, -1, -1, 0));
+      if (fd[e] < 0) error = errno;
+    }
+  }
+  ~PerfCounters() {
+    for (int e = 0; e < N_EVENTS; e++)
+      if (fd[e] >= 0) close(fd[e]);
+  }
+  PerfCounters(PerfCounters const&) = delete;
+  PerfCounters& operator=(PerfCounters const&) = delete;
+  bool available(int e) const {
+    return fd[e] >= 0;
+  }
+  bool any_available() const {
+    for (int e = 0; e < N_EVENTS; e++)
+      if (available(e)) return true;
+    return false;
+  }
+  /*
+   * why the last counter which is not available could not be opened
+   */
+  std::string why() const {
+    return std::strerror(error);
+  }
+  Values read() const {
+    Values r;
+    for (int e = 0; e < N_EVENTS; e++) {
+      uint64_t buf[3];
+      if (fd[e] < 0 || ::read(fd[e], buf, sizeof(buf)) != sizeof(buf)) continue;
+      // buf : value, time enabled, time running
+      r.v[e] = (buf[2] == 0 ? 0.0 : static_cast<double>(buf[0]) * buf[1] / buf[2]);
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return r;
+  }
+  /*
+   * the counters of the calling thread
+   */
+  static PerfCounters& thread() {
+    static thread_local PerfCounters c;
+    return c;
+  }
+};
@@ -0,0 +1,198 @@
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+/*
+ * word-parallel half-steps on the slices of the full index.
+ * a slice is the 2^(SIZE - 1) positions with the same ppos, and the bit k
+ * of the index of a position in its slice is the point k (k < ppos) or
+ * k + 1 (k >= ppos) of the browns (see Board::to_index). the bitmap of a
+ * slice is read as 64 bit words, so the index bits 0 - 5 select a bit in
+ * a word and the higher ones select the word.
+ *
+ * a brown move from a to b xors the two index bits of a and b, so the
+ * brown positions which win by the move are a copy of the black slice
+ * with the words and the bits in the words exchanged (brown_word).
+ * a black move from ppos to t moves to another slice, in which the index
+ * bits are permuted (and flipped if the table has the flip symmetry), and
+ * the captured pairs are cleared (black_slice).
+ */
+template<int SIZE>
+class SliceKernel {
+public:
+  typedef uint64_t __attribute__((__may_alias__)) word;
+  static constexpr int BITS() { return SIZE - 1; }
+  static constexpr uint64_t WORDS() { return 1ull << (SIZE - 7); }
+  /*
+   * the bits of a word whose index bit a (< 6) is 1
+   */
+  static constexpr uint64_t low_mask(int a) {
+    constexpr uint64_t m[6] = {
+      0xaaaaaaaaaaaaaaaaull, 0xccccccccccccccccull, 0xf0f0f0f0f0f0f0f0ull,
+      0xff00ff00ff00ff00ull, 0xffff0000ffff0000ull, 0xffffffff00000000ull};
+    return m[a];
+  }
+  /*
+   * the bits of word q whose index bit a is 1
+   */
+  static uint64_t bit_mask(uint64_t q, int a) {
+    if (a < 6) return low_mask(a);
+    return ((q >> (a - 6)) & 1) != 0 ? ~0ull : 0ull;
+  }
+  /*
+   * bit r of the result is bit (r ^ m) of w (m < 64)
+   */
+  static uint64_t swap_in_word(uint64_t w, uint64_t m) {
+    for (int j = 0; j < 6; j++) {
+      if ((m & (1ull << j)) == 0) continue;
+      w = ((w & low_mask(j)) >> (1 << j)) | ((w & ~low_mask(j)) << (1 << j));
+    }
+    return w;
+  }
+  /*
+   * word q of the bitmap y with y[s] = x[s ^ m]
+   */
+  static uint64_t xor_word(word const* x, uint64_t q, uint64_t m) {
+    return swap_in_word(x[q ^ (m >> 6)], m & 63);
+  }
+  static int index_bit(int pos, int ppos) {
+    return pos < ppos ? pos : pos - 1;
+  }
+
+  /*
+   * the brown moves between the points a and b (index bits of the slice
+   * of ppos), in one or both directions
+   */
+  struct Move {
+    uint64_t m;
+    int a, b;
+    bool ab, ba;
+  };
+  static std::vector<Move> brown_moves(int ppos) {
+    std::vector<Move> r;
+    for (int a = 0; a < SIZE; a++) {
+      if (a == ppos) continue;
+      for (int b : Board<SIZE>::neighbors(a)) {
+	if (b == ppos) continue;
+	if (b < a && Board<SIZE>::neighbors(b).test(a)) continue;
+	int ia = index_bit(a, ppos), ib = index_bit(b, ppos);
+	r.push_back(Move{(1ull << ia) | (1ull << ib), ia, ib, true, Board<SIZE>::neighbors(b).test(a)});
+      }
+    }
+    return r;
+  }
+  /*
+   * word q of the brown positions of a slice which have a move to a
+   * position in `black', the black bitmap of the slice
+   */
+  static uint64_t brown_word(word const* black, std::vector<Move> const& moves, uint64_t q) {
+    uint64_t r = 0;
+    for (Move const& mv : moves) {
+      uint64_t ma = bit_mask(q, mv.a), mb = bit_mask(q, mv.b);
+      uint64_t c = (mv.ab ? ma & ~mb : 0) | (mv.ba ? mb & ~ma : 0);
+      if (c != 0) r |= xor_word(black, q, mv.m) & c;
+    }
+    return r;
+  }
+
+  /*
+   * x[s] = x[s'] for s' with the index bits i and j (i < j) of s exchanged
+   */
+  static void swap_index_bits(word *x, int i, int j) {
+    if (j < 6) {
+      uint64_t d = (1ull << j) - (1ull << i), m = low_mask(i) & ~low_mask(j);
+      for (uint64_t q = 0; q < WORDS(); q++) {
+	uint64_t t = ((x[q] >> d) ^ x[q]) & m;
+	x[q] ^= t ^ (t << d);
+      }
+    }
+    else if (i < 6) {
+      uint64_t hb = 1ull << (j - 6), mi = low_mask(i);
+      for (uint64_t q = 0; q < WORDS(); q++) {
+	if ((q & hb) != 0) continue;
+	uint64_t a = x[q], b = x[q | hb];
+	x[q] = (a & ~mi) | ((b & ~mi) << (1 << i));
+	x[q | hb] = (b & mi) | ((a & mi) >> (1 << i));
+      }
+    }
+    else {
+      uint64_t hi = 1ull << (i - 6), hj = 1ull << (j - 6);
+      for (uint64_t q = 0; q < WORDS(); q++)
+	if ((q & hi) != 0 && (q & hj) == 0) std::swap(x[q], x[q ^ hi ^ hj]);
+    }
+  }
+  /*
+   * x[s] = x[s'] where the index bit k of s is the bit p[k] of s'
+   * (p is made of transpositions, each of which is a pass over x)
+   */
+  static void permute(word *x, std::vector<int> p) {
+    for (int i = 0; i < BITS(); i++) {
+      if (p[i] == i) continue;
+      int j = p[i];
+      // p = (i j) * p', and p' fixes 0 .. i
+      for (int &k : p) k = (k == i ? j : k == j ? i : k);
+      swap_index_bits(x, std::min(i, j), std::max(i, j));
+    }
+  }
+  /*
+   * x[s] = x[s ^ (1 << u) ^ (1 << v)] for s with the index bits u and v
+   * (u < v) both set.
+   * the words read are not written, or are read before they are written.
+   */
+  static void capture(word *x, int u, int v) {
+    uint64_t m = (1ull << u) | (1ull << v);
+    for (uint64_t q = 0; q < WORDS(); q++) {
+      uint64_t both = bit_mask(q, u) & bit_mask(q, v);
+      if (both != 0) x[q] = (x[q] & ~both) | (xor_word(x, q, m) & both);
+    }
+  }
+  /*
+   * the slice in which the move of the black piece from ppos to t is
+   * stored (the slice of a position with ppos >= HSIZE() is that of the
+   * flipped position if flip is true)
+   */
+  static int move_slice(int t, bool flip) {
+    return (flip && t >= Board<SIZE>::HSIZE() ? Board<SIZE>::flip_pos(t) : t);
+  }
+  /*
+   * acc[s] &= (the move of the black position s of the slice of ppos to t
+   * leads to a position in `brown', or is not possible)
+   * brown : the brown bitmap of move_slice(t, flip)
+   * tmp : WORDS() words
+   */
+  static void black_move(word const* brown, int ppos, int t, bool flip, word *acc, word *tmp) {
+    bool flipped = (move_slice(t, flip) != t);
+    auto f = [&](int pos) { return flipped ? Board<SIZE>::flip_pos(pos) : pos; };
+    int tt = f(t);
+    std::copy(brown, brown + WORDS(), tmp);
+    // the point t (empty before the move) is where ppos is in the next position
+    std::vector<int> p(BITS());
+    for (int k = 0; k < SIZE; k++) {
+      if (k == ppos) continue;
+      p[index_bit(k, ppos)] = index_bit(f(k == t ? ppos : k), tt);
+    }
+    permute(tmp, p);
+    for (int i = 0; i < 4; i++) {
+      uint64_t c2 = Board<SIZE>::captures(t, i).val();
+      if (c2 == 0ull) break;
+      // ppos is empty after the move
+      if ((c2 & (1ull << ppos)) != 0) continue;
+      int u = index_bit(bsf(c2), ppos), v = index_bit(bsf(c2 & (c2 - 1)), ppos);
+      capture(tmp, u, v);
+    }
+    int it = index_bit(t, ppos);
+    for (uint64_t q = 0; q < WORDS(); q++)
+      acc[q] &= tmp[q] | bit_mask(q, it);
+  }
+  /*
+   * acc : the black positions of the slice of ppos all of whose moves lead
+   * to the positions in `brown', the brown bitmap of the whole table
+   * tmp : WORDS() words for the slice of each move
+   */
+  static void black_slice(word const* brown, int ppos, bool flip, word *acc, word *tmp) {
+    std::fill(acc, acc + WORDS(), ~0ull);
+    for (int t : Board<SIZE>::neighbors(ppos))
+      black_move(brown + static_cast<uint64_t>(move_slice(t, flip)) * WORDS(), ppos, t, flip, acc, tmp);
+  }
+};
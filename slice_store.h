@@ -0,0 +1,86 @@
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <list>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+
+/*
+ * the slices of the tables kept in files (one file for each slice), of
+ * which at most `capacity' are in memory at a time.
+ * get(k) loads slice k in place of the least recently used one (written
+ * back if it has been changed), and the files are made (all zero) when
+ * the store is made and removed with it.
+ * bytes_read and bytes_written are the bytes moved between the memory
+ * and the files.
+ */
+class SliceStore {
+  typedef std::vector<uint64_t, HugePageAllocator<uint64_t>> Buffer;
+  struct Slot {
+    int k = -1;
+    bool dirty = false;
+    Buffer words;
+  };
+  std::vector<std::string> fnames;
+  uint64_t words;
+  std::vector<Slot> slots;
+  // slots in the order of use (the last one is the most recently used)
+  std::list<int> lru;
+  std::vector<int> slot_of;
+
+  void write_back(Slot &s) {
+    if (s.k < 0 || !s.dirty) return;
+    std::fstream f(fnames[s.k], std::ios::binary|std::ios::in|std::ios::out);
+    f.write((char const*)&s.words[0], words * 8);
+    if (!f) throw std::runtime_error("cannot write " + fnames[s.k]);
+    bytes_written += words * 8;
+    s.dirty = false;
+  }
+public:
+  uint64_t bytes_read = 0, bytes_written = 0;
+
+  SliceStore(std::vector<std::string> const& fnames_, uint64_t words_, size_t capacity)
+    :fnames(fnames_), words(words_), slots(capacity), slot_of(fnames_.size(), -1) {
+    for (auto const& fname : fnames) {
+      std::ofstream(fname, std::ios::binary|std::ios::trunc);
+      std::filesystem::resize_file(fname, words * 8);
+    }
+    for (size_t i = 0; i < slots.size(); i++) {
+      slots[i].words = Buffer(words);
+      lru.push_back(i);
+    }
+  }
+  ~SliceStore() {
+    for (auto const& fname : fnames) std::remove(fname.c_str());
+  }
+  size_t capacity() const {
+    return slots.size();
+  }
+  bool cached(int k) const {
+    return slot_of[k] >= 0;
+  }
+  /*
+   * the words of slice k. dirty : the slice is going to be changed
+   */
+  uint64_t *get(int k, bool dirty) {
+    int i = slot_of[k];
+    if (i < 0) {
+      i = lru.front();
+      Slot &s = slots[i];
+      write_back(s);
+      if (s.k >= 0) slot_of[s.k] = -1;
+      std::ifstream f(fnames[k], std::ios::binary);
+      f.read((char *)&s.words[0], words * 8);
+      if (!f) throw std::runtime_error("cannot read " + fnames[k]);
+      bytes_read += words * 8;
+      s.k = k;
+      slot_of[k] = i;
+    }
+    lru.remove(i);
+    lru.push_back(i);
+    slots[i].dirty |= dirty;
+    return &slots[i].words[0];
+  }
+};
@@ -1,26 +1,171 @@
 #include "board.h"
+#include "delta_file.h"
+#include "worker_pool.h"
+#include "huge_pages.h"
+#include "bit_table.h"
+#include "slice_kernel.h"
+#include "slice_store.h"
+#include "telemetry.h"
+#include "perf_counters.h"
+#include "exchange_dir.h"
+#include "cache_tiles.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <csignal>
 #include <fstream>
 #include <chrono>
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <memory>
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
+/*
+ * a table is zero when it is made, and is not written until it is used
+ * (see HugePages)
+ */
+using Table = std::vector<uint8_t, HugePageAllocator<uint8_t>>;
+
 constexpr size_t bytesize(uint64_t sz) {
   return ((sz + 7) / 8);
 }
 
-void set_table(std::vector<uint8_t> &table, uint64_t pos) {
+void set_table(Table &table, uint64_t pos) {
   table[pos / 8] |= (1 << (pos % 8));
 }
 
-bool test_table(std::vector<uint8_t> const& table, uint64_t pos) {
+bool test_table(Table const& table, uint64_t pos) {
   return (table[pos / 8] & (1 << (pos % 8))) != 0;
 }
 
+/*
+ * set the bit from several threads at once.
+ * returns true if the bit was not set before.
+ */
+bool set_table_atomic(Table &table, uint64_t pos) {
+  uint8_t mask = (1 << (pos % 8));
+  return (__atomic_fetch_or(&table[pos / 8], mask, __ATOMIC_RELAXED) & mask) == 0;
+}
+
+void set_table(BitTable &table, uint64_t pos) {
+  table.set(pos);
+}
+
+bool test_table(BitTable const& table, uint64_t pos) {
+  return table.test(pos);
+}
+
+bool set_table_atomic(BitTable &table, uint64_t pos) {
+  return table.set_atomic(pos);
+}
+
+/*
+ * 4-bit counters packed two per byte
+ */
+int get_counter(Table const& counter, uint64_t pos) {
+  return (counter[pos / 2] >> (4 * (pos % 2))) & 15;
+}
+
+void set_counter(Table &counter, uint64_t pos, int c) {
+  int shift = 4 * (pos % 2);
+  counter[pos / 2] = (counter[pos / 2] & ~(15 << shift)) | (c << shift);
+}
+
+/*
+ * decrement the counter from several threads at once.
+ * returns true if the counter has reached zero.
+ */
+bool dec_counter_atomic(Table &counter, uint64_t pos) {
+  int shift = 4 * (pos % 2);
+  uint8_t old = __atomic_load_n(&counter[pos / 2], __ATOMIC_RELAXED);
+  for (;;) {
+    assert(((old >> shift) & 15) != 0);
+    uint8_t n = old - (1 << shift);
+    if (__atomic_compare_exchange_n(&counter[pos / 2], &old, n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      return ((n >> shift) & 15) == 0;
+  }
+}
+
 std::mutex io_lock;
 
+/*
+ * numa mode : the workers are pinned to cpus spread over the NUMA nodes,
+ * and the bytes of a table for the chunks in the initial share of a worker
+ * (see WorkerPool) are put on the node of the worker, so that the sweeps
+ * access local memory. the random probes for successors are then spread
+ * evenly over the nodes, as they would be by interleaving.
+ */
+std::unique_ptr<WorkerPool> make_pool(NumaNodes const& numa, int num_workers, bool use_numa) {
+  if (!use_numa) return std::make_unique<WorkerPool>(num_workers);
+  std::vector<int> cpus = numa.thread_cpus(num_workers), nodes;
+  for (int c : cpus) nodes.push_back(numa.node_of_cpu(c));
+  std::cerr << "numa : nodes=" << numa.size() << ", cpus of the workers =";
+  for (int c : cpus) std::cerr << " " << c;
+  std::cerr << std::endl;
+  return std::make_unique<WorkerPool>(num_workers, cpus, nodes);
+}
+
+/*
+ * put the table of `size' indices (bytes_per_chunk bytes for each chunk of
+ * `chunk' indices) on the nodes of the workers whose initial shares sweep it
+ */
+void place_shares(NumaNodes const& numa, WorkerPool const& pool, uint8_t *base, uint64_t size, uint64_t chunk, uint64_t bytes_per_chunk) {
+  uint64_t n_chunks = (size + chunk - 1) / chunk;
+  for (int n = 0; n < pool.num_workers(); n++) {
+    uint64_t b = WorkerPool::share_begin(n_chunks, n, pool.num_workers()) * bytes_per_chunk;
+    uint64_t e = WorkerPool::share_begin(n_chunks, n + 1, pool.num_workers()) * bytes_per_chunk;
+    numa.bind(base + b, e - b, pool.node(n));
+  }
+}
+
+/*
+ * the sampled pages of a table placed by place_shares which are on the
+ * node of their worker, and the sampled pages (whose node is known)
+ */
+std::pair<uint64_t, uint64_t> local_pages(NumaNodes const& numa, WorkerPool const& pool, uint8_t const* base, uint64_t size, uint64_t chunk, uint64_t bytes_per_chunk) {
+  uint64_t n_chunks = (size + chunk - 1) / chunk, local = 0, sampled = 0;
+  for (uint64_t j = 0; j < n_chunks * bytes_per_chunk; j += 64 * 4096) {
+    int node = numa.page_node(base + j);
+    if (node < 0) continue;
+    sampled++;
+    if (node == pool.node(WorkerPool::share_owner(n_chunks, j / bytes_per_chunk, pool.num_workers()))) local++;
+  }
+  return std::make_pair(local, sampled);
+}
+
+/*
+ * index_type : FULL_INDEX - Board::to_index() (ppos < HSIZE() unless NO_SYMMETRY())
+ *              COMPACT_INDEX - CompactIndex (the positions which can appear in a game)
+ *              D4_INDEX - D4Index (SIZE = 25 and capture_type 0 or 1)
+ */
+enum {
+  FULL_INDEX,
+  COMPACT_INDEX,
+  D4_INDEX
+};
+
+/*
+ * options of TableMaker::solve
+ */
+struct SolveOptions {
+  int n_workers = 8;
+  bool frontier = false;
+  bool counter = false;
+  bool resume = false;
+  bool delta = false;
+  bool depth = false;
+  bool numa = false;
+  bool kernel = false;
+  // the NDJSON file of the metrics and the port serving them (see Telemetry)
+  std::string metrics;
+  int metrics_port = 0;
+  bool perf = false;
+  bool tile = false;
+  // the positions of a batch of the pull half-steps (0 : one at a time)
+  int batch = 0;
+};
+
 /*
  * capter_type : 0 - brown can capture a black piece at anywhere
  *               1 - brown can capture a black piece at one of four corners
@@ -28,7 +173,7 @@ std::mutex io_lock;
  *               3 - brown can capture a black piece at (1, 0)
  *               4 - brown can capture a black piece at (2, 0)
  */
-template<int SIZE, int capture_type = 0>
+template<int SIZE, int capture_type = 0, int index_type = FULL_INDEX>
 class TableMaker {
   static constexpr bool NO_SYMMETRY() {
     if (capture_type == 2 || capture_type == 3 || capture_type == 4) return true;
@@ -46,6 +191,96 @@ class TableMaker {
   static constexpr size_t table_size() {
     return h_table_size() * 2;
   }
+  static constexpr int ppos_size() {
+    if (NO_SYMMETRY())
+      return SIZE;
+    else
+      return Board<SIZE>::HSIZE();
+  }
+  typedef CompactIndex<SIZE, ppos_size()> Compact;
+  static constexpr size_t index_size() {
+    if constexpr (index_type == COMPACT_INDEX)
+      return Compact::size();
+    else if constexpr (index_type == D4_INDEX)
+      return d4index.size();
+    else
+      return h_table_size();
+  }
+  /*
+   * the stored position which has the same value as b
+   */
+  static Board<SIZE> canonical(Board<SIZE> const& b) {
+    if constexpr (index_type == D4_INDEX)
+      return d4index.canonical(b);
+    if (!NO_SYMMETRY() && b.v >= table_size()) return b.flip();
+    return b;
+  }
+  /*
+   * call f(n) for the positions n with canonical(n) == b
+   */
+  template<typename F>
+  static void for_images(Board<SIZE> const& b, F f) {
+    if constexpr (index_type == D4_INDEX) {
+      d4index.for_images(b, f);
+      return;
+    }
+    f(b);
+    if (!NO_SYMMETRY() && b.flip().v >= table_size()) f(b.flip());
+  }
+  static uint64_t to_index(Board<SIZE> const& b) {
+    if constexpr (index_type == COMPACT_INDEX)
+      return Compact::to_index(b);
+    else if constexpr (index_type == D4_INDEX)
+      return d4index.to_index(b);
+    else
+      return b.to_index();
+  }
+  /*
+   * to_index(canonical(b))
+   */
+  static uint64_t canonical_index(Board<SIZE> const& b) {
+    if constexpr (index_type == D4_INDEX)
+      return d4index.canonical_index(b);
+    else
+      return to_index(canonical(b));
+  }
+  static Board<SIZE> from_index(uint64_t i, int turn) {
+    if constexpr (index_type == COMPACT_INDEX)
+      return Compact::from_index(i, turn);
+    else if constexpr (index_type == D4_INDEX)
+      return d4index.from_index(i, turn);
+    else
+      return Board<SIZE>::from_index(i, turn);
+  }
+  /*
+   * call f(i, b) for the positions b with index i in [start, end)
+   */
+  template<typename F>
+  static void for_range(uint64_t start, uint64_t end, int turn, F f) {
+    if constexpr (index_type == COMPACT_INDEX) {
+      Compact::for_range(start, end, turn, f);
+      return;
+    }
+    if constexpr (index_type == D4_INDEX) {
+      d4index.for_range(start, end, turn, f);
+      return;
+    }
+    for (uint64_t i = start; i < end; i++)
+      f(i, from_index(i, turn));
+  }
+  /*
+   * a predecessor p is stored in the table
+   */
+  static bool stored(Board<SIZE> const& p) {
+    if constexpr (index_type == D4_INDEX)
+      return d4index.canonical(p).v == p.v;
+    if (!NO_SYMMETRY() && p.v >= table_size()) return false;
+    return index_type != COMPACT_INDEX || Compact::reachable(p);
+  }
+  static std::string file_name(std::string const& color, int step, char const* ext = ".bin") {
+    static char const* const infix[] = {"_", "_C_", "_D4_"};
+    return color + "_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + infix[index_type] + std::to_string(step) + ext;
+  }
 
 /*
   0 - unknown
@@ -55,114 +290,644 @@ class TableMaker {
  2*n + 1 - (black turn) all black move lead to state 2*m (m <= n) 
  */
 
-  std::vector<uint8_t> table_brown, table_black;
+  /*
+   * the blocks of the tables are lists of positions while they are sparse
+   * (see BitTable)
+   */
+  BitTable table_brown, table_black;
 
 public:
   TableMaker()
-    :table_brown(bytesize(h_table_size()), 0),
-     table_black(bytesize(h_table_size()), 0) {
-    std::cerr << "TableMaker : constructor(SIZE=" << SIZE << ",capture_type = " << capture_type << std::endl;
+    :table_brown(bytesize(index_size())),
+     table_black(bytesize(index_size())) {
+    std::cerr << "TableMaker : constructor(SIZE=" << SIZE << ",capture_type = " << capture_type << ",index_type = " << index_type << std::endl;
   }
   static constexpr int BSIZE() { return 256; }
+  /*
+   * the sweeps over the indices are split into chunks of a page of the
+   * bitmaps, which are shared by the threads of `pool' (see WorkerPool).
+   * (the bits of a chunk are not in the same byte as those of another chunk)
+   */
+  static constexpr uint64_t CHUNK() { return 8 * 4096; }
+  std::unique_ptr<WorkerPool> pool;
+  NumaNodes numa;
   std::atomic<uint64_t> changed;
-  static void init_worker(TableMaker* tm, int num_workers, int n) {
+  /*
+   * frontier mode : the positions set in the previous half-step are kept
+   * in `frontier' as long as there are at most `frontier_limit' of them.
+   * A step whose frontier is known pushes the updates to the predecessors
+   * of the frontier (push), otherwise it sweeps the whole table (pull).
+   * Like direction-optimizing BFS, push is chosen when
+   *   frontier * PUSH_ALPHA(is_black) < undecided positions of the step
+   * PUSH_ALPHA is the ratio between the cost of pushing one frontier position
+   * and the cost of sweeping one undecided position (measured on SIZE=25).
+   */
+  static constexpr size_t PUSH_ALPHA(bool is_black) {
+    return is_black ? 16 : 2;
+  }
+  bool use_frontier = false;
+  /*
+   * counter mode : counter[i] is the number of moves from the black
+   * position i which do not lead to the positions in table_brown.
+   * setting a brown position decrements the counters of its predecessors,
+   * and a black step sets the undecided positions whose counter is zero.
+   * (a black position has at most 8 moves, so 4 bits are enough.)
+   */
+  bool use_counter = false;
+  Table counter;
+  uint64_t decided_black = 0, decided_brown = 0;
+  size_t frontier_limit = 0;
+  std::vector<uint64_t> frontier, next_frontier;
+  std::atomic<bool> frontier_overflow;
+  std::mutex frontier_lock;
+  /*
+   * delta mode : a step writes only the indices set in the step
+   * (<color>_<SIZE>_<capture_type><infix><step>.delta, see DeltaWriter)
+   * instead of the snapshot of the whole table.
+   * they are the bits of the table which are not in `prev_table', the copy
+   * of the table before the step (push_worker sets them in any order).
+   */
+  bool use_delta = false;
+  BitTable prev_table;
+  /*
+   * depth mode : depth[turn * index_size() + i] is the step in which the
+   * position i is set (0 if not yet), and count_<SIZE>_<capture_type>.bin
+   * is written from it at the end, without any snapshot or merge_result.
+   */
+  bool use_depth = false;
+  Table depth;
+  /*
+   * kernel mode (full index) : the pull half-steps update the words of a
+   * slice at once (see SliceKernel) instead of each position.
+   * the black kernel makes a copy of each slice a move leads to, so it is
+   * used only when a slice is small (SIZE 25) and without counter mode.
+   */
+  bool use_kernel = false;
+  typedef SliceKernel<SIZE> Kernel;
+  /*
+   * metrics (see Telemetry) : a record for each step, with the positions
+   * swept per second of each thread, the positions skipped as decided
+   * (visited and skipped of ThreadStats, counted in the sweeps), the
+   * positions set by the number of their browns, the resident memory and
+   * the bytes written, and progress records with the time left in a step.
+   */
+  std::unique_ptr<Telemetry> telemetry;
+  struct alignas(64) ThreadStats {
+    uint64_t visited = 0, skipped = 0;
+    std::vector<uint64_t> changed_browns;
+  };
+  std::vector<ThreadStats> thread_stats;
+  std::chrono::steady_clock::time_point step_start;
+  uint64_t step_size = 0, bytes_written = 0;
+  /*
+   * the positions set by this thread in the run, by the number of browns
+   */
+  static std::vector<uint64_t>& changed_browns() {
+    static thread_local std::vector<uint64_t> c(SIZE, 0);
+    return c;
+  }
+  static int index_browns(uint64_t i) {
+    if (index_type == FULL_INDEX) return popcnt(i & ((1ull << (SIZE - 1)) - 1));
+    return from_index(i, Board<SIZE>::black).browns_size();
+  }
+  /*
+   * perf mode : the hardware counters (see PerfCounters) of each thread in
+   * the init, in each half-step and in writing the step are reported with
+   * their averages per position (positions swept, or written).
+   */
+  bool use_perf = false;
+  std::vector<PerfCounters::Values> perf_values;
+  void report_perf(std::string const& phase, uint64_t positions, std::vector<PerfCounters::Values> const& values) {
+    PerfCounters const& pc = PerfCounters::thread();
+    PerfCounters::Values total;
+    for (auto const& v : values) total += v;
+    auto counts = [&](std::ostream& os, PerfCounters::Values const& v, uint64_t positions, bool averages) {
+      double per = 1.0 / std::max<uint64_t>(positions, 1);
+      os << "busy[s]=" << v.seconds << ", ns/position=" << v.seconds * 1e9 * per;
+      for (int e = 0; e < PerfCounters::N_EVENTS; e++) {
+	if (!pc.available(e)) continue;
+	os << ", " << PerfCounters::name(e) << "=" << static_cast<uint64_t>(v.v[e]);
+	if (averages) os << " (" << v.v[e] * per << "/position)";
+      }
+      if (pc.available(PerfCounters::CYCLES) && pc.available(PerfCounters::INSTRUCTIONS))
+	os << ", ipc=" << v.v[PerfCounters::INSTRUCTIONS] / std::max(v.v[PerfCounters::CYCLES], 1.0);
+    };
+    std::cerr << "perf : " << phase << " positions=" << positions << ", ";
+    counts(std::cerr, total, positions, true);
+    std::cerr << std::endl;
+    // the positions of a thread are those of its chunks
+    if (values.size() > 1) {
+      for (size_t n = 0; n < values.size(); n++) {
+	uint64_t items = pool->items(n), size = std::max<uint64_t>(step_size, 1);
+	std::cerr << "perf :  thread " << n << " positions=" << positions * items / size << ", ";
+	counts(std::cerr, values[n], positions * items / size, false);
+	std::cerr << std::endl;
+      }
+    }
+    if (telemetry) {
+      double per = 1.0 / std::max<uint64_t>(positions, 1);
+      Telemetry::Record r("perf");
+      r.add("phase", phase).add("positions", positions).add("busy_s", total.seconds);
+      for (int e = 0; e < PerfCounters::N_EVENTS; e++)
+	if (pc.available(e)) r.add(PerfCounters::name(e), total.v[e]).add(std::string(PerfCounters::name(e)) + "_per_position", total.v[e] * per);
+      telemetry->emit(r);
+    }
+  }
+  uint64_t write_step_perf(int step) {
+    if (!use_perf) return write_step(step);
+    PerfCounters::Values start = PerfCounters::thread().read();
+    uint64_t r = write_step(step);
+    report_perf("write step=" + std::to_string(step), index_size(), {PerfCounters::thread().read() - start});
+    return r;
+  }
+  void add_stats(int n, uint64_t visited, uint64_t skipped) {
+    if (!telemetry) return;
+    thread_stats[n].visited += visited;
+    thread_stats[n].skipped += skipped;
+  }
+  /*
+   * the progress of the run of the step (from the progress lines of the
+   * sweeps)
+   */
+  void emit_progress(int step) {
+    if (!telemetry) return;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - step_start).count();
+    uint64_t done = pool->done();
+    double rate = done / std::max(seconds, 1e-9);
+    telemetry->emit(Telemetry::Record("progress").add("step", step).add("done", done).add("size", step_size)
+		    .add("positions_per_s", rate).add("step_eta_s", (step_size - std::min(done, step_size)) / std::max(rate, 1e-9)), false);
+  }
+  void emit_step(int step, std::string const& mode, uint64_t positions, uint64_t step_bytes, double elapsed) {
+    if (!telemetry) return;
+    double seconds = pool->wall() / 1000;
+    std::vector<Telemetry::Record> threads;
+    std::vector<uint64_t> by_browns(SIZE, 0);
+    uint64_t visited = 0, skipped = 0;
+    for (int n = 0; n < pool->num_workers(); n++) {
+      ThreadStats& t = thread_stats[n];
+      threads.push_back(std::move(Telemetry::Record().add("n", n).add("busy_s", pool->busy(n) / 1000).add("positions", pool->items(n))
+				  .add("positions_per_s", pool->items(n) / std::max(pool->busy(n) / 1000, 1e-9))));
+      for (int k = 0; k < SIZE; k++) by_browns[k] += t.changed_browns[k];
+      visited += t.visited;
+      skipped += t.skipped;
+      t = ThreadStats();
+      t.changed_browns.assign(SIZE, 0);
+    }
+    telemetry->emit(Telemetry::Record("step").add("step", step).add("color", color(step)).add("mode", mode)
+		    .add("changed", changed.load()).add("changed_by_browns", by_browns)
+		    .add("decided_black", decided_black).add("decided_brown", decided_brown)
+		    .add("seconds", seconds).add("elapsed_s", elapsed).add("positions", positions)
+		    .add("positions_per_s", positions / std::max(seconds, 1e-9))
+		    .add("visited", visited).add("skipped", skipped)
+		    .add("early_exit_rate", visited == 0 ? 0.0 : static_cast<double>(skipped) / visited)
+		    .add("threads", threads)
+		    .add("rss", Telemetry::rss()).add("step_bytes", step_bytes).add("bytes_written", bytes_written));
+  }
+  static constexpr bool BLACK_KERNEL() { return SIZE == 25; }
+
+  void add_frontier(std::vector<uint64_t> &l_frontier, bool overflow) {
+    if (frontier_limit == 0) return;
+    if (overflow) frontier_overflow = true;
+    if (frontier_overflow) return;
+    std::lock_guard<std::mutex> l_(frontier_lock);
+    if (next_frontier.size() + l_frontier.size() > frontier_limit) {
+      frontier_overflow = true;
+      std::vector<uint64_t>().swap(next_frontier);
+      return;
+    }
+    next_frontier.insert(next_frontier.end(), l_frontier.begin(), l_frontier.end());
+  }
+  static void record(TableMaker *tm, std::vector<uint64_t> &l_frontier, bool &overflow, uint64_t i) {
+    if (tm->telemetry) changed_browns()[index_browns(i)]++;
+    if (tm->frontier_limit == 0 || overflow) return;
+    if (l_frontier.size() >= tm->frontier_limit) {
+      overflow = true;
+      std::vector<uint64_t>().swap(l_frontier);
+      return;
+    }
+    l_frontier.push_back(i);
+  }
+  /*
+   * call f(i, p) for every black position p (with index i) in the table
+   * which has a move leading to the brown position with index k.
+   */
+  template<typename F>
+  static void for_black_preds(uint64_t k, F f) {
+    // the predecessors of the images of b look up b
+    for_images(from_index(k, Board<SIZE>::brown), [&](Board<SIZE> const& b) {
+	for (auto p_ : b.prev_states()) {
+	  Board<SIZE> p(p_);
+	  if (!stored(p)) continue;
+	  f(to_index(p), p);
+	}
+      });
+  }
+  void dec_black_preds(uint64_t k) {
+    for_black_preds(k, [&](uint64_t i, Board<SIZE> const&) {
+	dec_counter_atomic(counter, i);
+      });
+  }
+  /*
+   * all successors of the black position b are won by brown.
+   */
+  bool black_lost(Board<SIZE> const& b) const {
+    for (auto n_ : b.next_states()) {
+      if (!test_table(table_brown, canonical_index(Board<SIZE>(n_)))) return false;
+    }
+    return true;
+  }
+  /*
+   * one of the successors of the brown position b is lost by black.
+   */
+  bool brown_wins(Board<SIZE> const& b) const {
+    for (auto n_ : b.next_states()) {
+      if (test_table(table_black, canonical_index(Board<SIZE>(n_)))) return true;
+    }
+    return false;
+  }
+  /*
+   * the black piece at bpos can be captured
+   */
+  static bool initial_ppos(uint64_t bpos) {
+    if (capture_type == 2 &&
+	bpos != Board<SIZE>::toPos(0, 0)) return false;
+    if (capture_type == 3 &&
+	bpos != Board<SIZE>::toPos(1, 0)) return false;
+    if (capture_type == 4 &&
+	bpos != Board<SIZE>::toPos(2, 0)) return false;
+    if (capture_type == 1 &&
+	bpos != Board<SIZE>::toPos(0, 0) &&
+	bpos != Board<SIZE>::toPos(4, 0) &&
+	bpos != Board<SIZE>::toPos(0, 4) &&
+	bpos != Board<SIZE>::toPos(4, 4)) return false;
+    return true;
+  }
+  /*
+   * the black position b is lost at step 1
+   */
+  static bool initial_black(Board<SIZE> const& b) {
+    return initial_ppos(b.ppos()) && b.final_value() == 1;
+  }
+  static void init_worker(TableMaker* tm, int step, int n) {
     uint64_t l_changed = 0;
-    size_t s_index = BSIZE() * n;
-    for (size_t j = s_index; j < h_table_size(); j += BSIZE() * num_workers) {
-      for (size_t i = j; i < std::min(j + BSIZE(), h_table_size()); i++) {
+    std::vector<uint64_t> l_frontier;
+    bool overflow = false;
+    for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+      for_range(j, e, Board<SIZE>::black, [&](uint64_t i, Board<SIZE> const& b) {
 	if (i % 10000000 == 0) {
 	  {
 	    std::lock_guard<std::mutex> l_(io_lock);
 	    std::cerr << "init : i=" << i << std::endl;
+	    tm->emit_progress(step);
 	  }
 	}
-	Board<SIZE> b = Board<SIZE>::from_index(i, Board<SIZE>::black);
 	if (b.turn() == Board<SIZE>::black) {
-	  uint64_t bpos = b.ppos();
-	  if (capture_type == 2 &&
-	      bpos != Board<SIZE>::toPos(0, 0)) continue;
-	  if (capture_type == 3 &&
-	      bpos != Board<SIZE>::toPos(1, 0)) continue;
-	  if (capture_type == 4 &&
-	      bpos != Board<SIZE>::toPos(2, 0)) continue;
-	  if (capture_type == 1 &&
-	      bpos != Board<SIZE>::toPos(0, 0) &&
-	      bpos != Board<SIZE>::toPos(4, 0) &&
-	      bpos != Board<SIZE>::toPos(0, 4) &&
-	      bpos != Board<SIZE>::toPos(4, 4)) continue;
-	  if (b.final_value() == 1) {
+	  if (tm->use_counter) {
+	    int c = 0;
+	    for (auto n_ : b.next_states()) {
+	      (void)n_;
+	      c++;
+	    }
+	    set_counter(tm->counter, i, c);
+	  }
+	  if (initial_black(b)) {
 	    set_table(tm->table_black, i);
 	    l_changed++;
+	    record(tm, l_frontier, overflow, i);
 	  }
 	}
-      }
+	});
     }
     tm->changed += l_changed;
+    tm->add_frontier(l_frontier, overflow);
   }
 
 
-  static void worker(TableMaker *tm, int step, int num_workers, int n) {
-    //   std::cerr << "worker(step=" << step << ",num_workers=" << num_workers << ",n=" << n << std::endl;
-    uint64_t l_changed = 0;
-    size_t s_index = BSIZE() * n;
+  /*
+   * batch mode : the pull half-steps (but the kernels and the counters)
+   * take the undecided positions of a chunk `batch' at a time. the indices
+   * of all successors of a batch are made and their bytes of the table
+   * prefetched first, and they are tested afterwards (up to the first one
+   * deciding each position), so that the misses of the probes overlap
+   * instead of stalling one after another. it pays when the tables are
+   * much larger than the last level cache, as the successors are then all
+   * made even for the positions decided by the first of them.
+   */
+  int batch = 0;
+  /*
+   * call f(i, found) for the positions i in [j, e) with turn `turn' which
+   * are not set in `own', where found is true if the bit of one of their
+   * successors in `table' is `want'
+   */
+  template<typename F>
+  void for_batches(int step, uint64_t j, uint64_t e, int turn, BitTable const& own, BitTable const& table, bool want,
+		   uint64_t& visited, uint64_t& skipped, F f) {
+    std::vector<uint64_t> succs, positions;
+    std::vector<size_t> ends;
+    auto resolve = [&]() {
+      size_t s = 0;
+      for (size_t p = 0; p < positions.size(); p++) {
+	bool found = false;
+	for (; s < ends[p] && !found; s++) found = (test_table(table, succs[s]) == want);
+	s = ends[p];
+	f(positions[p], found);
+      }
+      succs.clear();
+      positions.clear();
+      ends.clear();
+    };
+    for_range(j, e, turn, [&](uint64_t i, Board<SIZE> const& b) {
+      if (i % 10000000 == 0) {
+	std::lock_guard<std::mutex> l_(io_lock);
+	std::cerr << "step=" << step << ", " << color(step) << " : i=" << i << std::endl;
+	emit_progress(step);
+      }
+      visited++;
+      if (test_table(own, i)) {
+	skipped++;
+	return;
+      }
+      for (auto n_ : b.next_states()) {
+	uint64_t k = canonical_index(Board<SIZE>(n_));
+	table.prefetch(k);
+	succs.push_back(k);
+      }
+      positions.push_back(i);
+      ends.push_back(succs.size());
+      if (positions.size() == static_cast<size_t>(batch)) resolve();
+      });
+    resolve();
+  }
+
+  static void worker(TableMaker *tm, int step, int n) {
+    //   std::cerr << "worker(step=" << step << ",n=" << n << std::endl;
+    uint64_t l_changed = 0, l_visited = 0, l_skipped = 0;
+    std::vector<uint64_t> l_frontier;
+    bool overflow = false;
     bool is_black = ((step & 1) == 1);
     if (is_black) {
-      for (size_t j = s_index; j < h_table_size(); j += BSIZE() * num_workers) {
-	for (size_t i = j; i < std::min(j + BSIZE(), h_table_size()); i++) {
+      for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+	if (tm->use_counter) {
+	  l_visited += e - j;
+	  for (size_t i = j; i < e; i++) {
+	    if (test_table(tm->table_black, i) != 0) {
+	      l_skipped++;
+	      continue;
+	    }
+	    if (get_counter(tm->counter, i) == 0) {
+	      set_table(tm->table_black, i);
+	      l_changed++;
+	      record(tm, l_frontier, overflow, i);
+	    }
+	  }
+	  continue;
+	}
+	if (tm->batch > 0) {
+	  // lost if no successor is not won by brown
+	  tm->for_batches(step, j, e, Board<SIZE>::black, tm->table_black, tm->table_brown, false, l_visited, l_skipped, [&](uint64_t i, bool found) {
+	    if (found) return;
+	    set_table(tm->table_black, i);
+	    l_changed++;
+	    record(tm, l_frontier, overflow, i);
+	    });
+	  continue;
+	}
+	for_range(j, e, Board<SIZE>::black, [&](uint64_t i, Board<SIZE> const& b) {
 	  if (i % 10000000 == 0) {
 	    std::lock_guard<std::mutex> l_(io_lock);
 	    std::cerr << "step=" << step << ", black : i=" << i << std::endl;
+	    tm->emit_progress(step);
+	  }
+	  l_visited++;
+	  if (test_table(tm->table_black, i) != 0) {
+	    l_skipped++;
+	    return;
 	  }
-	  if (test_table(tm->table_black, i) != 0) continue;
-	  Board<SIZE> b = Board<SIZE>::from_index(i, Board<SIZE>::black);
-	  if (b.to_index() != i) {
-	    std::cerr << "i=" << i << ",b.to_index()="  << b.to_index() << std::endl;
+	  if (to_index(b) != i) {
+	    std::cerr << "i=" << i << ",to_index(b)="  << to_index(b) << std::endl;
 	    throw std::runtime_error("index error");
 	  }
 	  // if (b.turn() != black) continue;
-	  bool has_escape = false;
-	  for (auto n_ : b.next_states()) {
-	    Board<SIZE> n(n_);
-	    if (!NO_SYMMETRY())
-	      if (n.v >= table_size()) n = n.flip();
-	    if (!test_table(tm->table_brown, n.to_index())) {
-	      has_escape = true; break;
-	    }
-	  }
-	  if (!has_escape) {
+	  if (tm->black_lost(b)) {
 	    set_table(tm->table_black, i);
 	    l_changed++;
+	    record(tm, l_frontier, overflow, i);
 	  }
-	}
+	  });
       }
     } else {
-      for (size_t j = s_index; j < h_table_size(); j += BSIZE() * num_workers) {
-	for (size_t i = j; i < std::min(j + BSIZE(), h_table_size()); i++) {
+      for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+	if (tm->batch > 0) {
+	  tm->for_batches(step, j, e, Board<SIZE>::brown, tm->table_brown, tm->table_black, true, l_visited, l_skipped, [&](uint64_t i, bool found) {
+	    if (!found) return;
+	    set_table(tm->table_brown, i);
+	    l_changed++;
+	    record(tm, l_frontier, overflow, i);
+	    if (tm->use_counter) tm->dec_black_preds(i);
+	    });
+	  continue;
+	}
+	for_range(j, e, Board<SIZE>::brown, [&](uint64_t i, Board<SIZE> const& b) {
 	  if (i % 10000000 == 0) {
 	    std::lock_guard<std::mutex> l_(io_lock);
 	    std::cerr << "step=" << step << ", brown : i=" << i << std::endl;
+	    tm->emit_progress(step);
 	  }
-	  if (test_table(tm->table_brown, i) != 0) continue;
-	  Board<SIZE> b = Board<SIZE>::from_index(i, Board<SIZE>::brown);
-	  if (b.to_index() != i) {
-	    std::cerr << "i=" << i << ",b.to_index()="  << b.to_index() << std::endl;
-	    throw std::runtime_error("index error");
+	  l_visited++;
+	  if (test_table(tm->table_brown, i) != 0) {
+	    l_skipped++;
+	    return;
 	  }
-	  bool has_capture = false;
-	  for (auto n_ : b.next_states()) {
-	    Board<SIZE> n(n_);
-	    if (test_table(tm->table_black, n.to_index())) {
-	      has_capture = true; break;
-	    }
+	  if (to_index(b) != i) {
+	    std::cerr << "i=" << i << ",to_index(b)="  << to_index(b) << std::endl;
+	    throw std::runtime_error("index error");
 	  }
-	  if (has_capture) {
+	  if (tm->brown_wins(b)) {
 	    set_table(tm->table_brown, i);
 	    l_changed++;
+	    record(tm, l_frontier, overflow, i);
+	    if (tm->use_counter) tm->dec_black_preds(i);
+	  }
+	  });
+      }
+    }
+    tm->changed += l_changed;
+    tm->add_stats(n, l_visited, l_skipped);
+    tm->add_frontier(l_frontier, overflow);
+  }
+
+  /*
+   * tile mode (full index) : a black move changes the ppos of a position,
+   * so the successors of a ppos slice are probed in the brown slices of
+   * all ppos its piece reaches, and each brown slice is read again from
+   * memory by the sweep of each of them. the black pull half-step goes
+   * over tiles of `tile_width' brown subsets (the low bits of the index)
+   * instead, and sweeps a tile in all ppos slices before the next one, so
+   * that the parts of the brown slices the tile probes (and their flipped
+   * images) stay in the last level cache. a tile is shared by no thread,
+   * but the chunks of BitTable are, so the bits are set atomically.
+   */
+  uint64_t tile_width = 0;
+  static void tiled_black_worker(TableMaker *tm, int step, int n) {
+    uint64_t l_changed = 0, l_visited = 0, l_skipped = 0;
+    std::vector<uint64_t> l_frontier;
+    bool overflow = false;
+    auto lost = [&](uint64_t i) {
+      if (!set_table_atomic(tm->table_black, i)) return;
+      l_changed++;
+      record(tm, l_frontier, overflow, i);
+    };
+    for (uint64_t t, te; tm->pool->next(n, t, te); ) {
+      for (; t < te; t++) {
+	for (int ppos = 0; ppos < ppos_size(); ppos++) {
+	  uint64_t j = ppos * pos_size() + t * tm->tile_width, e = j + tm->tile_width;
+	  if (tm->batch > 0) {
+	    tm->for_batches(step, j, e, Board<SIZE>::black, tm->table_black, tm->table_brown, false, l_visited, l_skipped, [&](uint64_t i, bool found) {
+	      if (!found) lost(i);
+	      });
+	    continue;
+	  }
+	  for_range(j, e, Board<SIZE>::black, [&](uint64_t i, Board<SIZE> const& b) {
+	    if (i % 10000000 == 0) {
+	      std::lock_guard<std::mutex> l_(io_lock);
+	      std::cerr << "step=" << step << ", black (tiled) : i=" << i << std::endl;
+	      tm->emit_progress(step);
+	    }
+	    l_visited++;
+	    if (test_table(tm->table_black, i)) {
+	      l_skipped++;
+	      return;
+	    }
+	    if (tm->black_lost(b)) lost(i);
+	    });
+	}
+      }
+    }
+    tm->changed += l_changed;
+    tm->add_stats(n, l_visited, l_skipped);
+    tm->add_frontier(l_frontier, overflow);
+  }
+
+  /*
+   * set the bits of r which are not in word q of the table, and returns them
+   */
+  static uint64_t set_word(BitTable &table, uint64_t q, uint64_t r) {
+    typename Kernel::word *w = reinterpret_cast<typename Kernel::word *>(table.data()) + q;
+    r &= ~*w;
+    *w |= r;
+    return r;
+  }
+  static void brown_kernel_worker(TableMaker *tm, int step, int n) {
+    uint64_t l_changed = 0;
+    std::vector<uint64_t> l_frontier;
+    bool overflow = false;
+    typename Kernel::word const* black = reinterpret_cast<typename Kernel::word const*>(tm->table_black.data());
+    for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+      int ppos = j >> Kernel::BITS();
+      auto moves = Kernel::brown_moves(ppos);
+      uint64_t base = static_cast<uint64_t>(ppos) * Kernel::WORDS();
+      for (uint64_t q = j / 64; q < e / 64; q++) {
+	uint64_t r = set_word(tm->table_brown, q, Kernel::brown_word(black + base, moves, q - base));
+	l_changed += popcnt(r);
+	for (; r != 0; r &= r - 1) {
+	  uint64_t i = q * 64 + bsf(r);
+	  record(tm, l_frontier, overflow, i);
+	  if (tm->use_counter) tm->dec_black_preds(i);
+	}
+      }
+    }
+    tm->changed += l_changed;
+    tm->add_frontier(l_frontier, overflow);
+  }
+  /*
+   * the chunks are the slices
+   */
+  static void black_kernel_worker(TableMaker *tm, int step, int n) {
+    uint64_t l_changed = 0;
+    std::vector<uint64_t> l_frontier;
+    bool overflow = false;
+    std::vector<uint64_t> acc(Kernel::WORDS()), tmp(Kernel::WORDS());
+    typename Kernel::word const* brown = reinterpret_cast<typename Kernel::word const*>(tm->table_brown.data());
+    for (uint64_t ppos, e; tm->pool->next(n, ppos, e); ) {
+      Kernel::black_slice(brown, ppos, !NO_SYMMETRY(), &acc[0], &tmp[0]);
+      uint64_t base = ppos * Kernel::WORDS();
+      for (uint64_t q = 0; q < Kernel::WORDS(); q++) {
+	uint64_t r = set_word(tm->table_black, base + q, acc[q]);
+	l_changed += popcnt(r);
+	for (; r != 0; r &= r - 1) record(tm, l_frontier, overflow, (base + q) * 64 + bsf(r));
+      }
+    }
+    tm->changed += l_changed;
+    tm->add_frontier(l_frontier, overflow);
+  }
+
+  /*
+   * push version of worker. only the predecessors of the positions set
+   * in the previous half-step can change in this half-step.
+   * (except for black positions without any move, which are set in step 3
+   *  when capture_type > 0. next_frontier_limit() never chooses step 3.)
+   */
+  static void push_worker(TableMaker *tm, int step, int n) {
+    uint64_t l_changed = 0;
+    std::vector<uint64_t> l_frontier;
+    bool overflow = false;
+    bool is_black = ((step & 1) == 1);
+    std::vector<uint64_t> const& frontier = tm->frontier;
+    for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+      for (size_t k = j; k < e; k++) {
+	if (is_black) {
+	  for_black_preds(frontier[k], [&](uint64_t i, Board<SIZE> const& p) {
+	      if (test_table(tm->table_black, i)) return;
+	      if (!tm->black_lost(p)) return;
+	      if (set_table_atomic(tm->table_black, i)) {
+		l_changed++;
+		record(tm, l_frontier, overflow, i);
+	      }
+	    });
+	} else {
+	  Board<SIZE> b = from_index(frontier[k], Board<SIZE>::black);
+	  for (auto p_ : b.prev_states()) {
+	    uint64_t i = canonical_index(Board<SIZE>(p_));
+	    if (set_table_atomic(tm->table_brown, i)) {
+	      l_changed++;
+	      record(tm, l_frontier, overflow, i);
+	      if (tm->use_counter) tm->dec_black_preds(i);
+	    }
 	  }
 	}
       }
     }
     tm->changed += l_changed;
+    tm->add_frontier(l_frontier, overflow);
+  }
+  size_t next_frontier_limit(int next_step) const {
+    bool is_black = ((next_step & 1) == 1);
+    if (!use_frontier) return 0;
+    if (is_black && (next_step < 5 || use_counter)) return 0;
+    uint64_t undecided = index_size() - (is_black ? decided_black : decided_brown);
+    return undecided / PUSH_ALPHA(is_black);
+  }
+  /*
+   * call f(this, step, n) on every thread n of the pool, which share the
+   * chunks of [0, size)
+   */
+  template<typename F>
+  void run_workers(F f, int step, uint64_t size = index_size(), uint64_t chunk = CHUNK()) {
+    step_start = std::chrono::steady_clock::now();
+    step_size = size;
+    pool->run([&](int n) {
+	if (use_perf) {
+	  PerfCounters::Values start = PerfCounters::thread().read();
+	  f(this, step, n);
+	  perf_values[n] = PerfCounters::thread().read() - start;
+	}
+	else
+	  f(this, step, n);
+	if (!telemetry) return;
+	std::vector<uint64_t>& c = changed_browns();
+	for (int k = 0; k < SIZE; k++) thread_stats[n].changed_browns[k] += c[k];
+	std::fill(c.begin(), c.end(), 0);
+      }, size, chunk);
   }
 
   static void write_stream(std::ofstream& os, char* buf, size_t size) {
@@ -172,75 +937,1252 @@ public:
       os.write(buf + i, wsize);
     }
   }
-  void solve(int num_workers) {
+  /*
+   * write the table through a temporary file, so that a file with the
+   * name of a snapshot is always complete
+   */
+  static void write_table(std::string const& fname, Table const& table) {
+    std::string tmp_name = fname + ".tmp";
+    std::ofstream f(tmp_name, std::ios::binary|std::ios::trunc);
+    write_stream(f, (char *)(&table[0]), table.size());
+    f.close();
+    if (!f) throw std::runtime_error("cannot write " + tmp_name);
+    if (std::rename(tmp_name.c_str(), fname.c_str()) != 0)
+      throw std::runtime_error("cannot rename " + tmp_name);
+  }
+  /*
+   * the empty blocks are holes of the file, so that the snapshot of a
+   * sparse table takes the space of its blocks with positions
+   */
+  static uint64_t write_table(std::string const& fname, BitTable const& table) {
+    std::string tmp_name = fname + ".tmp";
+    std::ofstream f(tmp_name, std::ios::binary|std::ios::trunc);
+    std::vector<uint8_t> buf(BitTable::BLOCK_BYTES());
+    bool skipped = false;
+    uint64_t written = 0;
+    for (uint64_t b = 0; b < table.blocks(); b++) {
+      if (table.empty(b)) {
+	skipped = true;
+	continue;
+      }
+      if (skipped) f.seekp(b * BitTable::BLOCK_BYTES());
+      skipped = false;
+      f.write((char const*)table.block(b, &buf[0]), table.block_size(b));
+      written += table.block_size(b);
+    }
+    f.close();
+    if (!f) throw std::runtime_error("cannot write " + tmp_name);
+    std::filesystem::resize_file(tmp_name, table.size());
+    if (std::rename(tmp_name.c_str(), fname.c_str()) != 0)
+      throw std::runtime_error("cannot rename " + tmp_name);
+    return written;
+  }
+  static std::string color(int step) {
+    return ((step & 1) == 1 ? "black" : "brown");
+  }
+  BitTable const& step_table(int step) const {
+    return ((step & 1) == 1 ? table_black : table_brown);
+  }
+  /*
+   * call f(i) for the indices set in the step, in increasing order
+   */
+  template<typename F>
+  void for_step_bits(int step, F f) const {
+    BitTable const& table = step_table(step);
+    std::vector<uint8_t> buf(BitTable::BLOCK_BYTES()), prev_buf(BitTable::BLOCK_BYTES());
+    for (uint64_t b = 0; b < table.blocks(); b++) {
+      // the bits of the block in prev_table are also in the table
+      if (!table.is_dense(b) && table.sparse_bits(b) == prev_table.sparse_bits(b)) continue;
+      uint8_t const* d = table.block(b, &buf[0]);
+      uint8_t const* p = prev_table.block(b, &prev_buf[0]);
+      for (size_t j = 0; j < table.block_size(b); j++) {
+	for (uint8_t x = d[j] & ~p[j]; x != 0; x &= x - 1)
+	  f((b * BitTable::BLOCK_BYTES() + j) * 8 + bsf(x));
+      }
+    }
+  }
+  void write_delta(int step) {
+    DeltaWriter w(file_name(color(step), step, ".delta"));
+    for_step_bits(step, [&](uint64_t i) { w.put(i); });
+    w.close();
+  }
+  uint8_t *step_depth(int step) {
+    return &depth[(step & 1) == 1 ? 0 : index_size()];
+  }
+  /*
+   * returns the bytes written
+   */
+  uint64_t write_step(int step) {
+    if (use_depth) {
+      uint8_t *d = step_depth(step);
+      for_step_bits(step, [&](uint64_t i) { d[i] = step; });
+    }
+    if (use_delta) {
+      write_delta(step);
+      return std::filesystem::file_size(file_name(color(step), step, ".delta"));
+    }
+    if (!use_depth)
+      return write_table(file_name(color(step), step), step_table(step));
+    return 0;
+  }
+  /*
+   * count_<SIZE>_<capture_type>.bin in the order of Board::v, which is
+   * the same as the output of merge_result
+   */
+  void write_count() {
+    std::string fname = "count_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + ".bin";
+    std::string tmp_name = fname + ".tmp";
+    std::ofstream f(tmp_name, std::ios::binary|std::ios::trunc);
+    std::vector<uint8_t> buf(0x1000000);
+    for (uint64_t v = 0; v < table_size(); v += buf.size()) {
+      size_t n = std::min<uint64_t>(buf.size(), table_size() - v);
+      for (size_t k = 0; k < n; k++) {
+	Board<SIZE> b(v + k);
+	if (index_type == COMPACT_INDEX && !Compact::reachable(b))
+	  buf[k] = 0;
+	else
+	  buf[k] = depth[b.turn() * index_size() + canonical_index(b)];
+      }
+      f.write((char *)&buf[0], n);
+    }
+    f.close();
+    if (!f) throw std::runtime_error("cannot write " + tmp_name);
+    if (std::rename(tmp_name.c_str(), fname.c_str()) != 0)
+      throw std::runtime_error("cannot rename " + tmp_name);
+  }
+  bool check_step(int step) const {
+    if (use_delta)
+      return std::ifstream(file_name(color(step), step, ".delta")).is_open();
+    return check_table(file_name(color(step), step), table_black);
+  }
+  template<typename T>
+  static bool check_table(std::string const& fname, T const& table) {
+    std::ifstream f(fname, std::ios::binary|std::ios::ate);
+    return f.is_open() && static_cast<size_t>(f.tellg()) == table.size();
+  }
+  static void read_table(std::string const& fname, Table &table) {
+    std::ifstream f(fname, std::ios::binary);
+    f.read((char *)(&table[0]), table.size());
+    if (!f) throw std::runtime_error("cannot read " + fname);
+  }
+  static void read_table(std::string const& fname, BitTable &table) {
+    std::ifstream f(fname, std::ios::binary);
+    std::vector<uint8_t> buf(BitTable::BLOCK_BYTES());
+    for (uint64_t b = 0; b < table.blocks(); b++) {
+      f.read((char *)&buf[0], table.block_size(b));
+      table.load_block(b, &buf[0]);
+    }
+    if (!f) throw std::runtime_error("cannot read " + fname);
+  }
+  /*
+   * checkpoint : the snapshots of a step and of the step before it are
+   * the whole state of the solver except for the frontier and the counters.
+   * (in delta mode, the tables are the union of the deltas up to the step.)
+   * returns the step of the latest checkpoint (0 if there is none).
+   */
+  int load_checkpoint() {
+    int last = 0;
+    while (last + 1 < 256 && check_step(last + 1)) last++;
+    if (last < 2) return 0;
+    if (use_delta) {
+      for (int step = 1; step <= last; step++) {
+	BitTable &table = ((step & 1) == 1 ? table_black : table_brown);
+	DeltaReader r(file_name(color(step), step, ".delta"));
+	for (uint64_t i; r.next(i); ) {
+	  set_table(table, i);
+	  if (use_depth) step_depth(step)[i] = step;
+	}
+      }
+    }
+    else {
+      read_table(file_name(color(last), last), (last & 1) == 1 ? table_black : table_brown);
+      read_table(file_name(color(last - 1), last - 1), (last & 1) == 1 ? table_brown : table_black);
+    }
+    decided_black = table_black.count();
+    decided_brown = table_brown.count();
+    std::cerr << "resume from step=" << last << ", black=" << decided_black << ", brown=" << decided_brown << std::endl;
+    return last;
+  }
+  /*
+   * the positions set in step `last' are those in its snapshot which are
+   * not in the snapshot of step `last - 2' (or those in its delta)
+   */
+  void restore_frontier(int last) {
+    frontier_limit = next_frontier_limit(last + 1);
+    frontier_overflow = false;
+    if (frontier_limit == 0) return;
+    std::vector<uint64_t> l_frontier;
+    bool overflow = false;
+    if (use_delta) {
+      DeltaReader r(file_name(color(last), last, ".delta"));
+      for (uint64_t i; !overflow && r.next(i); ) record(this, l_frontier, overflow, i);
+      add_frontier(l_frontier, overflow);
+      return;
+    }
+    BitTable const& table = ((last & 1) == 1 ? table_black : table_brown);
+    Table prev(table.size());
+    if (last > 2) read_table(file_name(color(last - 2), last - 2), prev);
+    std::vector<uint8_t> buf(BitTable::BLOCK_BYTES());
+    for (uint64_t b = 0; b < table.blocks() && !overflow; b++) {
+      uint8_t const* d = table.block(b, &buf[0]);
+      for (size_t j = 0; j < table.block_size(b); j++) {
+	uint64_t k = b * BitTable::BLOCK_BYTES() + j;
+	for (uint8_t x = d[j] & ~prev[k]; x != 0; x &= x - 1)
+	  record(this, l_frontier, overflow, k * 8 + bsf(x));
+      }
+    }
+    add_frontier(l_frontier, overflow);
+  }
+  /*
+   * the counters of black positions from the tables of a checkpoint
+   */
+  static void counter_worker(TableMaker *tm, int step, int n) {
+    for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+      for_range(j, e, Board<SIZE>::black, [&](uint64_t i, Board<SIZE> const& b) {
+	  int c = 0;
+	  for (auto n_ : b.next_states())
+	    if (!test_table(tm->table_brown, canonical_index(Board<SIZE>(n_)))) c++;
+	  set_counter(tm->counter, i, c);
+	});
+    }
+  }
+  /*
+   * see make_pool
+   */
+  void place_tables() {
+    if (numa.size() <= 1) {
+      std::cerr << "numa : one node, the tables are not placed" << std::endl;
+      return;
+    }
+    place_shares(numa, *pool, table_black.data(), index_size(), CHUNK(), CHUNK() / 8);
+    place_shares(numa, *pool, table_brown.data(), index_size(), CHUNK(), CHUNK() / 8);
+    if (use_counter) place_shares(numa, *pool, &counter[0], index_size(), CHUNK(), CHUNK() / 2);
+    if (use_depth) {
+      place_shares(numa, *pool, &depth[0], index_size(), CHUNK(), CHUNK());
+      place_shares(numa, *pool, &depth[index_size()], index_size(), CHUNK(), CHUNK());
+    }
+    auto p = local_pages(numa, *pool, table_black.data(), index_size(), CHUNK(), CHUNK() / 8);
+    std::cerr << "numa : pages of table_black on the node of their worker = " << p.first << "/" << p.second << std::endl;
+  }
+  void solve(SolveOptions const& opts) {
     // std::string prefix="/mnt/sda1/ktanaka/";
-    std::cerr << "start solving SIZE=" << SIZE << ", num_workers=" << num_workers << std::endl;
+    int num_workers = opts.n_workers;
+    std::cerr << "start solving SIZE=" << SIZE << ", num_workers=" << num_workers << ", frontier=" << opts.frontier << ", counter=" << opts.counter << ", index_type=" << index_type << ", resume=" << opts.resume << ", delta=" << opts.delta << ", depth=" << opts.depth << ", numa=" << opts.numa << ", kernel=" << opts.kernel << ", perf=" << opts.perf << ", batch=" << opts.batch << ", tile=" << opts.tile << std::endl;
+    // the depths of the steps are only in the deltas
+    if (opts.depth && opts.resume && !opts.delta)
+      throw std::runtime_error("--resume with --depth needs --delta");
     auto chrono_start = std::chrono::system_clock::now();
     changed = 0;
-    if (num_workers == 1) {
-      init_worker(this, num_workers, 0);
+    use_frontier = opts.frontier;
+    use_counter = opts.counter;
+    use_delta = opts.delta;
+    use_depth = opts.depth;
+    use_kernel = opts.kernel;
+    batch = std::max(opts.batch, 0);
+    if (use_kernel && index_type != FULL_INDEX)
+      throw std::runtime_error("--kernel needs the full index");
+    if (opts.tile && index_type != FULL_INDEX)
+      throw std::runtime_error("--tile needs the full index");
+    tile_width = 0;
+    if (opts.tile) {
+      // a column of a tile : the black bit and the brown bits of the successors and of their flipped images in every slice
+      size_t llc = CacheTiles::llc_bytes();
+      tile_width = CacheTiles::width(llc > 0 ? llc : 8 << 20, ppos_size() * 3, pos_size(), num_workers, 4096);
+      std::cerr << "tile : llc=" << llc << " bytes, tile_width=" << tile_width << ", tiles=" << pos_size() / tile_width << std::endl;
     }
-    else {
-      std::vector<std::thread> threads(num_workers);
-      for (int i = 0; i < num_workers; i++) {
-	threads[i] = std::thread(init_worker, this, num_workers, i);
-      }
-      for (int i = 0; i < num_workers; i++) {
-	threads[i].join();
+    pool = make_pool(numa, num_workers, opts.numa);
+    auto elapsed = [&]() {
+      return std::chrono::duration<double>(std::chrono::system_clock::now() - chrono_start).count();
+    };
+    if (!opts.metrics.empty() || opts.metrics_port != 0) {
+      telemetry = std::make_unique<Telemetry>(opts.metrics, opts.metrics_port);
+      thread_stats.assign(num_workers, ThreadStats());
+      for (auto &t : thread_stats) t.changed_browns.assign(SIZE, 0);
+      telemetry->emit(Telemetry::Record("start").add("size", SIZE).add("capture_type", capture_type).add("index_type", index_type)
+		      .add("index_size", index_size()).add("n_workers", num_workers).add("batch", batch).add("tile_width", tile_width));
+    }
+    use_perf = opts.perf;
+    if (use_perf) {
+      perf_values.assign(num_workers, PerfCounters::Values());
+      PerfCounters const& pc = PerfCounters::thread();
+      if (pc.any_available()) {
+	std::cerr << "perf : counters";
+	for (int e = 0; e < PerfCounters::N_EVENTS; e++)
+	  if (pc.available(e)) std::cerr << " " << PerfCounters::name(e);
+	std::cerr << std::endl;
       }
+      else
+	std::cerr << "perf : no hardware counters (" << pc.why() << "), wall-clock only" << std::endl;
     }
-    std::cerr << "changed = " << changed << std::endl;
-    {
-      std::string fname = "black_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_" + std::to_string(1) + ".bin";
+    if (use_depth) {
+      depth = Table(index_size() * 2);
+      std::cerr << "depth table : " << depth.size() << " bytes" << std::endl;
+    }
+    if (use_counter) {
+      counter = Table((index_size() + 1) / 2);
+      std::cerr << "counter table : " << counter.size() << " bytes" << std::endl;
+    }
+    if (opts.numa) place_tables();
+    HugePages::report(std::cerr);
+    int last = (opts.resume ? load_checkpoint() : 0);
+    if (last > 0) {
+      if (use_counter) run_workers(counter_worker, last);
+      restore_frontier(last);
+    } else {
+      frontier_limit = next_frontier_limit(2);
+      frontier_overflow = false;
+      if (use_delta || use_depth) prev_table = BitTable(table_black.size());
+      run_workers(init_worker, 1);
+      std::cerr << "changed = " << changed << std::endl;
+      pool->report(std::cerr);
+      if (use_perf) report_perf("init", index_size(), perf_values);
+      decided_black += changed;
       // fname = prefix + fname;
-      std::ofstream f(fname, std::ios::binary);
-      // f.write((char *)(&table_black[0]), table_black.size());
-      write_stream(f, (char *)(&table_black[0]), table_black.size());
-      f.close();
+      uint64_t step_bytes = write_step_perf(1);
+      bytes_written += step_bytes;
+      emit_step(1, "init", index_size(), step_bytes, elapsed());
+      last = 1;
     }
-    for (int step = 2; step < 256; step++) {
+    for (int step = last + 1; step < 256; step++) {
       auto chrono_end = std::chrono::system_clock::now();
       std::cerr << "Elapsed time:" << std::chrono::duration_cast<std::chrono::milliseconds>(chrono_end - chrono_start).count() << "[ms]" << std::endl;
 
-      std::cerr << "step=" << step << std::endl;
+      bool push = (frontier_limit > 0 && !frontier_overflow);
+      frontier.swap(next_frontier);
+      std::vector<uint64_t>().swap(next_frontier);
+      if (!push) std::vector<uint64_t>().swap(frontier);
+      frontier_overflow = false;
+      frontier_limit = next_frontier_limit(step + 1);
+      std::cerr << "step=" << step << (push ? ", push : frontier=" + std::to_string(frontier.size()) : ", pull") << std::endl;
       changed = 0;
-      if (num_workers == 1) {
-	worker(this, step, num_workers, 0);
+      if (use_delta || use_depth) prev_table = step_table(step);
+      // the kernels read and write the words of the tables
+      if (use_kernel && !push) {
+	table_black.dense();
+	table_brown.dense();
+      }
+      table_black.adapt();
+      table_brown.adapt();
+      std::string mode = "pull";
+      uint64_t positions = (push ? frontier.size() : index_size());
+      if (push) {
+	mode = "push";
+	run_workers(push_worker, step, frontier.size(), BSIZE());
+      }
+      else if (use_kernel && (step & 1) == 0) {
+	mode = "kernel";
+	run_workers(brown_kernel_worker, step);
+      }
+      else if (use_kernel && BLACK_KERNEL() && !use_counter) {
+	mode = "kernel";
+	run_workers(black_kernel_worker, step, ppos_size(), 1);
+      }
+      else if (tile_width > 0 && (step & 1) == 1 && !use_counter) {
+	mode = "tiled";
+	run_workers(tiled_black_worker, step, pos_size() / tile_width, 1);
       }
       else {
-	std::vector<std::thread> threads(num_workers);
-	for (int i = 0; i < num_workers; i++) {
-	  threads[i] =std::thread(worker, this, step, num_workers, i);
-	}
-	for (int i = 0; i < num_workers; i++) {
-	  threads[i].join();
-	}
+	if (batch > 0 && !(use_counter && (step & 1) == 1)) mode = "batch=" + std::to_string(batch);
+	run_workers(worker, step);
       }
       std::cerr << "changed = " << changed << std::endl;
+      pool->report(std::cerr);
+      std::cerr << "blocks : dense black=" << table_black.dense_blocks() << ", brown=" << table_brown.dense_blocks() << "/" << table_black.blocks() << std::endl;
+      if (use_perf) report_perf("step=" + std::to_string(step) + " " + color(step) + " " + mode, positions, perf_values);
+      ((step & 1) == 1 ? decided_black : decided_brown) += changed;
+      // if (step < 5) fname = prefix + fname;
+      uint64_t step_bytes = (changed == 0 ? 0 : write_step_perf(step));
+      bytes_written += step_bytes;
+      emit_step(step, mode, positions, step_bytes, elapsed());
       if (changed == 0) break;
-      if ((step & 1) == 1) {
-	std::string fname = "black_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_" + std::to_string(step) + ".bin";
-	// if (step < 5) fname = prefix + fname;
-	std::ofstream f(fname, std::ios::binary);
-	// f.write((char *)(&table_black[0]), table_black.size());
-	write_stream(f, (char *)(&table_black[0]), table_black.size());
-	f.close();
+    }
+    HugePages::report(std::cerr);
+    if (use_depth) write_count();
+    if (telemetry)
+      telemetry->emit(Telemetry::Record("end").add("elapsed_s", elapsed()).add("decided_black", decided_black).add("decided_brown", decided_brown)
+		      .add("rss", Telemetry::rss()).add("bytes_written", bytes_written));
+  }
+};
+
+/*
+ * solve one layer of positions with the same number of browns at a time.
+ * brown moves keep the number of browns, and a black move captures 0 - 4
+ * pairs of browns, so layer k only depends on layers k, k - 2, ..., k - 8.
+ * only the two bitmaps of layer k and the brown bitmaps of the lower
+ * layers (at the previous step) are resident.
+ * positions in a layer are numbered by ppos and the rank of the browns
+ * (see Combination), and each layer writes its own snapshots
+ *  black_<SIZE>_<capture_type>_L<k>_<step>.bin
+ *  brown_<SIZE>_<capture_type>_L<k>_<step>.bin
+ * for the steps in which the layer has changed.
+ */
+template<int SIZE, int capture_type = 0>
+class LayeredTableMaker {
+  static constexpr bool NO_SYMMETRY() {
+    if (capture_type == 2 || capture_type == 3 || capture_type == 4) return true;
+    else return false;
+  }
+  static constexpr size_t pos_size() {
+    return (1ull << (SIZE - 1));
+  }
+  static constexpr size_t ppos_size() {
+    if (NO_SYMMETRY())
+      return SIZE;
+    else
+      return Board<SIZE>::HSIZE();
+  }
+  static constexpr size_t table_size() {
+    return pos_size() * ppos_size() * 2;
+  }
+  static constexpr int LOWER_SIZE() { return 4; }
+
+  int k;
+  Table table_brown, table_black;
+  Table lower_brown[LOWER_SIZE()];
+  int lower_step[LOWER_SIZE()];
+  // the steps in which brown positions of each layer have changed
+  std::vector<std::vector<int> > brown_steps;
+
+public:
+  LayeredTableMaker() :k(0), brown_steps(SIZE) {
+    std::cerr << "LayeredTableMaker : constructor(SIZE=" << SIZE << ",capture_type = " << capture_type << std::endl;
+  }
+  static uint64_t layer_size(int k) {
+    return ppos_size() * combination.binomial(SIZE - 1, k);
+  }
+  static uint64_t layer_index(Board<SIZE> const& b, int k) {
+    uint64_t i = b.to_index();
+    return (i >> (SIZE - 1)) * combination.binomial(SIZE - 1, k) + combination.rank(i & (pos_size() - 1));
+  }
+  static std::string file_name(std::string const& color, int k, int step) {
+    return color + "_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_L" + std::to_string(k) + "_" + std::to_string(step) + ".bin";
+  }
+  static constexpr uint64_t CHUNK() { return 8 * 4096; }
+  std::unique_ptr<WorkerPool> pool;
+  NumaNodes numa;
+  bool use_numa = false;
+  std::atomic<uint64_t> changed;
+
+  /*
+   * a brown position in this layer or in a lower layer is won by brown
+   */
+  bool test_brown(Board<SIZE> n) const {
+    if (!NO_SYMMETRY())
+      if (n.v >= table_size()) n = n.flip();
+    int kn = n.browns_size();
+    if (kn == k) return test_table(table_brown, layer_index(n, k));
+    return test_table(lower_brown[(k - kn) / 2 - 1], layer_index(n, kn));
+  }
+  /*
+   * call f(i, b) for the positions b with index i in [start, end) of the layer
+   */
+  template<typename F>
+  void for_range(uint64_t start, uint64_t end, int turn, F f) const {
+    uint64_t c = combination.binomial(SIZE - 1, k);
+    uint64_t ppos = start / c, r = start % c;
+    uint64_t browns = combination.unrank(r, k);
+    for (uint64_t i = start; i < end; i++) {
+      f(i, Board<SIZE>::from_index((ppos << (SIZE - 1)) | browns, turn));
+      if (++r == c) {
+	r = 0;
+	ppos++;
+	browns = (1ull << k) - 1;
+      } else {
+	browns = Combination::next(browns);
+      }
+    }
+  }
+  static void init_worker(LayeredTableMaker* tm, int step, int n) {
+    uint64_t l_changed = 0;
+    for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+      tm->for_range(j, e, Board<SIZE>::black, [&](uint64_t i, Board<SIZE> const& b) {
+	  if (TableMaker<SIZE, capture_type>::initial_black(b)) {
+	    set_table(tm->table_black, i);
+	    l_changed++;
+	  }
+	});
+    }
+    tm->changed += l_changed;
+  }
+  static void worker(LayeredTableMaker* tm, int step, int n) {
+    uint64_t l_changed = 0;
+    bool is_black = ((step & 1) == 1);
+    for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+      if (is_black) {
+	tm->for_range(j, e, Board<SIZE>::black, [&](uint64_t i, Board<SIZE> const& b) {
+	    if (test_table(tm->table_black, i)) return;
+	    for (auto n_ : b.next_states()) {
+	      if (!tm->test_brown(Board<SIZE>(n_))) return;
+	    }
+	    set_table(tm->table_black, i);
+	    l_changed++;
+	  });
       } else {
-	std::string fname = "brown_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_" + std::to_string(step) + ".bin";
-	//	if (step < 5) fname = prefix + fname;
-	std::ofstream f(fname, std::ios::binary);
-	// f.write((char *)(&table_brown[0]), table_brown.size());
-	write_stream(f, (char *)(&table_brown[0]), table_brown.size());
-	f.close();
+	tm->for_range(j, e, Board<SIZE>::brown, [&](uint64_t i, Board<SIZE> const& b) {
+	    if (test_table(tm->table_brown, i)) return;
+	    for (auto n_ : b.next_states()) {
+	      if (test_table(tm->table_black, layer_index(Board<SIZE>(n_), tm->k))) {
+		set_table(tm->table_brown, i);
+		l_changed++;
+		return;
+	      }
+	    }
+	  });
+      }
+    }
+    tm->changed += l_changed;
+  }
+  template<typename F>
+  void run_workers(F f, int step) {
+    pool->run([&](int n) { f(this, step, n); }, layer_size(k), CHUNK());
+  }
+  /*
+   * load the brown bitmaps of the lower layers as of the end of `step'
+   */
+  void load_lower(int step) {
+    for (int l = 0; l < LOWER_SIZE(); l++) {
+      int kl = k - 2 * (l + 1);
+      if (kl < 0) break;
+      int last = 0;
+      for (int s : brown_steps[kl])
+	if (s <= step) last = s;
+      if (last == lower_step[l]) continue;
+      std::ifstream f(file_name("brown", kl, last), std::ios::binary);
+      f.read((char *)(&lower_brown[l][0]), lower_brown[l].size());
+      if (!f) throw std::runtime_error("cannot read " + file_name("brown", kl, last));
+      lower_step[l] = last;
+    }
+  }
+  void write_table(std::string const& color, int step) {
+    Table const& table = (color == "black" ? table_black : table_brown);
+    TableMaker<SIZE, capture_type>::write_table(file_name(color, k, step), table);
+  }
+  void solve_layer() {
+    uint64_t size = layer_size(k);
+    table_black = Table(bytesize(size));
+    table_brown = Table(bytesize(size));
+    size_t resident = table_black.size() + table_brown.size();
+    int last_lower = 0;
+    for (int l = 0; l < LOWER_SIZE(); l++) {
+      int kl = k - 2 * (l + 1);
+      if (kl < 0) {
+	Table().swap(lower_brown[l]);
+	continue;
+      }
+      lower_brown[l] = Table(bytesize(layer_size(kl)));
+      // only probed at random in this layer
+      if (use_numa) numa.interleave(&lower_brown[l][0], lower_brown[l].size());
+      lower_step[l] = 0;
+      resident += lower_brown[l].size();
+      for (int s : brown_steps[kl])
+	last_lower = std::max(last_lower, s);
+    }
+    if (use_numa) {
+      place_shares(numa, *pool, &table_black[0], size, CHUNK(), CHUNK() / 8);
+      place_shares(numa, *pool, &table_brown[0], size, CHUNK(), CHUNK() / 8);
+    }
+    std::cerr << "layer=" << k << ", size=" << size << ", resident=" << resident << " bytes" << std::endl;
+    changed = 0;
+    run_workers(init_worker, 1);
+    std::cerr << "layer=" << k << ", step=1, changed = " << changed << std::endl;
+    pool->report(std::cerr);
+    if (changed != 0) write_table("black", 1);
+    for (int step = 2; step < 256; step++) {
+      bool is_black = ((step & 1) == 1);
+      if (is_black) load_lower(step - 1);
+      changed = 0;
+      run_workers(worker, step);
+      std::cerr << "layer=" << k << ", step=" << step << ", changed = " << changed << std::endl;
+      pool->report(std::cerr);
+      if (changed != 0) {
+	write_table(is_black ? "black" : "brown", step);
+	if (!is_black) brown_steps[k].push_back(step);
       }
+      // later steps depend only on the changes in this step and on the
+      // changes of the lower layers (black positions without any move
+      // are set in step 3)
+      else if (step > 2 && step > last_lower) break;
     }
   }
+  void solve(int num_workers, bool use_numa_ = false) {
+    std::cerr << "start solving by layers SIZE=" << SIZE << ", num_workers=" << num_workers << ", numa=" << use_numa_ << std::endl;
+    auto chrono_start = std::chrono::system_clock::now();
+    use_numa = use_numa_;
+    pool = make_pool(numa, num_workers, use_numa);
+    for (k = 0; k < SIZE; k++) {
+      solve_layer();
+      auto chrono_end = std::chrono::system_clock::now();
+      std::cerr << "Elapsed time:" << std::chrono::duration_cast<std::chrono::milliseconds>(chrono_end - chrono_start).count() << "[ms]" << std::endl;
+    }
+    HugePages::report(std::cerr);
+  }
 };
 
+template<int SIZE>
+bool solve_layered(int capture_type, int n_workers, bool numa) {
+  if (capture_type == 0)
+    LayeredTableMaker<SIZE, 0>().solve(n_workers, numa);
+  else if (capture_type == 1)
+    LayeredTableMaker<SIZE, 1>().solve(n_workers, numa);
+  else if (capture_type == 2)
+    LayeredTableMaker<SIZE, 2>().solve(n_workers, numa);
+  else if (capture_type == 3)
+    LayeredTableMaker<SIZE, 3>().solve(n_workers, numa);
+  else if (capture_type == 4)
+    LayeredTableMaker<SIZE, 4>().solve(n_workers, numa);
+  else
+    return false;
+  return true;
+}
+
+/*
+ * all capture types at once (full index, snapshots of the steps) : bit c
+ * of the byte of a position in the tables is its bit in the tables of
+ * TableMaker<SIZE, c>, and a sweep makes the moves of a position and
+ * their indices once for all types. the types with the flip symmetry
+ * (0 and 1) are solved over all ppos like the others, and their
+ * snapshots are the part of the tables with ppos < HSIZE(), which is
+ * their index.
+ * as in TableMaker, a type is finished at the first step in which it has
+ * not changed, and the sweeps only look at the types not finished.
+ */
+template<int SIZE>
+class MultiTableMaker {
+  static constexpr int N_TYPES() { return 5; }
+  static constexpr size_t pos_size() {
+    return (1ull << (SIZE - 1));
+  }
+  static constexpr size_t index_size() {
+    return pos_size() * SIZE;
+  }
+  /*
+   * the size of the index of TableMaker<SIZE, c>
+   */
+  static constexpr size_t type_size(int c) {
+    return pos_size() * (c <= 1 ? Board<SIZE>::HSIZE() : SIZE);
+  }
+  static constexpr uint64_t CHUNK() { return 8 * 4096; }
+
+  // one byte per position
+  Table table_black, table_brown;
+  // the types which are not finished
+  uint8_t active = (1 << N_TYPES()) - 1;
+  std::atomic<uint64_t> changed[N_TYPES()];
+  NumaNodes numa;
+  std::unique_ptr<WorkerPool> pool;
+
+  /*
+   * the types in which the black position b is lost at step 1
+   */
+  static uint8_t initial_types(Board<SIZE> const& b) {
+    if (b.final_value() != 1) return 0;
+    bool lost[N_TYPES()] = {
+      TableMaker<SIZE, 0>::initial_ppos(b.ppos()),
+      TableMaker<SIZE, 1>::initial_ppos(b.ppos()),
+      TableMaker<SIZE, 2>::initial_ppos(b.ppos()),
+      TableMaker<SIZE, 3>::initial_ppos(b.ppos()),
+      TableMaker<SIZE, 4>::initial_ppos(b.ppos())
+    };
+    uint8_t r = 0;
+    for (int c = 0; c < N_TYPES(); c++)
+      if (lost[c]) r |= 1 << c;
+    return r;
+  }
+  static void count(uint64_t *l_changed, uint8_t m) {
+    for (; m != 0; m &= m - 1) l_changed[__builtin_ctz(m)]++;
+  }
+  void add_changed(uint64_t const* l_changed) {
+    for (int c = 0; c < N_TYPES(); c++) changed[c] += l_changed[c];
+  }
+  static void init_worker(MultiTableMaker *tm, int step, int n) {
+    uint64_t l_changed[N_TYPES()] = {};
+    for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+      for (uint64_t i = j; i < e; i++) {
+	uint8_t m = initial_types(Board<SIZE>::from_index(i, Board<SIZE>::black));
+	tm->table_black[i] = m;
+	count(l_changed, m);
+      }
+    }
+    tm->add_changed(l_changed);
+  }
+  static void worker(MultiTableMaker *tm, int step, int n) {
+    bool is_black = ((step & 1) == 1);
+    Table &own = (is_black ? tm->table_black : tm->table_brown);
+    Table const& other = (is_black ? tm->table_brown : tm->table_black);
+    uint64_t l_changed[N_TYPES()] = {};
+    for (uint64_t j, e; tm->pool->next(n, j, e); ) {
+      for (uint64_t i = j; i < e; i++) {
+	if (i % 10000000 == 0) {
+	  std::lock_guard<std::mutex> l_(io_lock);
+	  std::cerr << "step=" << step << ", " << (is_black ? "black" : "brown") << " : i=" << i << std::endl;
+	}
+	uint8_t undecided = tm->active & ~own[i];
+	if (undecided == 0) continue;
+	Board<SIZE> b = Board<SIZE>::from_index(i, is_black ? Board<SIZE>::black : Board<SIZE>::brown);
+	uint8_t m;
+	if (is_black) {
+	  // the types in which all successors are won by brown
+	  m = undecided;
+	  for (auto n_ : b.next_states())
+	    if ((m &= other[Board<SIZE>(n_).to_index()]) == 0) break;
+	} else {
+	  // the types in which one of the successors is lost by black
+	  m = 0;
+	  for (auto n_ : b.next_states())
+	    if ((m |= other[Board<SIZE>(n_).to_index()] & undecided) == undecided) break;
+	}
+	own[i] |= m;
+	count(l_changed, m);
+      }
+    }
+    tm->add_changed(l_changed);
+  }
+  template<typename F>
+  void run_workers(F f, int step) {
+    pool->run([&](int n) { f(this, step, n); }, index_size(), CHUNK());
+  }
+  static std::string file_name(std::string const& color, int c, int step) {
+    return color + "_" + std::to_string(SIZE) + "_" + std::to_string(c) + "_" + std::to_string(step) + ".bin";
+  }
+  /*
+   * the snapshots of the types in `types' (bit c for type c) after the
+   * step, made by one pass over the table
+   */
+  void write_step(int step, uint8_t types) {
+    Table const& table = ((step & 1) == 1 ? table_black : table_brown);
+    std::string color = ((step & 1) == 1 ? "black" : "brown");
+    std::ofstream f[N_TYPES()];
+    for (int c = 0; c < N_TYPES(); c++)
+      if ((types >> c) & 1) f[c].open(file_name(color, c, step) + ".tmp", std::ios::binary|std::ios::trunc);
+    std::vector<uint8_t> buf[N_TYPES()];
+    for (auto &b : buf) b.resize(0x100000);
+    for (uint64_t i = 0; i < index_size(); i += buf[0].size() * 8) {
+      size_t n = std::min<uint64_t>(buf[0].size(), (index_size() - i) / 8);
+      for (size_t k = 0; k < n; k++) {
+	uint8_t bits[N_TYPES()] = {};
+	for (int j = 0; j < 8; j++) {
+	  uint8_t x = table[i + k * 8 + j];
+	  for (int c = 0; c < N_TYPES(); c++) bits[c] |= ((x >> c) & 1) << j;
+	}
+	for (int c = 0; c < N_TYPES(); c++) buf[c][k] = bits[c];
+      }
+      for (int c = 0; c < N_TYPES(); c++)
+	if ((types >> c) & 1 && i < type_size(c))
+	  f[c].write((char const*)&buf[c][0], std::min<uint64_t>(n, (type_size(c) - i) / 8));
+    }
+    for (int c = 0; c < N_TYPES(); c++) {
+      if (((types >> c) & 1) == 0) continue;
+      std::string fname = file_name(color, c, step);
+      f[c].close();
+      if (!f[c]) throw std::runtime_error("cannot write " + fname + ".tmp");
+      if (std::rename((fname + ".tmp").c_str(), fname.c_str()) != 0)
+	throw std::runtime_error("cannot rename " + fname + ".tmp");
+    }
+  }
+  /*
+   * the types which have changed in the step
+   */
+  uint8_t changed_types() const {
+    uint8_t r = 0;
+    for (int c = 0; c < N_TYPES(); c++)
+      if (changed[c] != 0) r |= 1 << c;
+    return r;
+  }
+  void report_changed() const {
+    std::cerr << "changed =";
+    for (int c = 0; c < N_TYPES(); c++) std::cerr << " " << changed[c];
+    std::cerr << std::endl;
+  }
+public:
+  MultiTableMaker() :table_black(index_size()), table_brown(index_size()) {
+    std::cerr << "MultiTableMaker : constructor(SIZE=" << SIZE << ", capture_types=0-" << N_TYPES() - 1 << ")" << std::endl;
+  }
+  void solve(int num_workers, bool use_numa) {
+    std::cerr << "start solving all capture types SIZE=" << SIZE << ", num_workers=" << num_workers << ", numa=" << use_numa << std::endl;
+    auto chrono_start = std::chrono::system_clock::now();
+    pool = make_pool(numa, num_workers, use_numa);
+    if (use_numa) {
+      place_shares(numa, *pool, &table_black[0], index_size(), CHUNK(), CHUNK());
+      place_shares(numa, *pool, &table_brown[0], index_size(), CHUNK(), CHUNK());
+    }
+    HugePages::report(std::cerr);
+    for (auto &c : changed) c = 0;
+    run_workers(init_worker, 1);
+    report_changed();
+    pool->report(std::cerr);
+    write_step(1, active);
+    for (int step = 2; step < 256 && active != 0; step++) {
+      auto chrono_end = std::chrono::system_clock::now();
+      std::cerr << "Elapsed time:" << std::chrono::duration_cast<std::chrono::milliseconds>(chrono_end - chrono_start).count() << "[ms]" << std::endl;
+      std::cerr << "step=" << step << ", capture types=" << static_cast<int>(active) << std::endl;
+      for (auto &c : changed) c = 0;
+      run_workers(worker, step);
+      report_changed();
+      pool->report(std::cerr);
+      uint8_t types = changed_types() & active;
+      if (types != 0) write_step(step, types);
+      // the types which have not changed are finished
+      active = types;
+    }
+    auto chrono_end = std::chrono::system_clock::now();
+    std::cerr << "Elapsed time:" << std::chrono::duration_cast<std::chrono::milliseconds>(chrono_end - chrono_start).count() << "[ms]" << std::endl;
+    HugePages::report(std::cerr);
+  }
+};
+
+/*
+ * the processes of the partitioned solver
+ *  parts : the number of parts (1 : not partitioned)
+ *  part : the part solved by this process, or -1 for all parts in child
+ *   processes and the coordinator (unless coordinator is true)
+ */
+struct PartitionOptions {
+  int parts = 1;
+  int part = -1;
+  bool coordinator = false;
+  std::string exchange;
+};
+
+/*
+ * out-of-core solver (full index) for tables larger than the memory.
+ * the bitmaps are kept in the files of their slices (the positions with
+ * the same ppos, see SliceKernel)
+ *  black_<SIZE>_<capture_type>_S<ppos>.slice
+ *  brown_<SIZE>_<capture_type>_S<ppos>.slice
+ * and as many of them as the memory limit allows are in memory (SliceStore).
+ * a brown half-step on a slice reads the black slice with the same ppos,
+ * and a black half-step reads the brown slices of the neighbors of ppos.
+ * the next slice of a half-step is the one with the most of these slices
+ * in memory, so that the neighbors shared by the slices are read once.
+ * each step writes <color>_<SIZE>_<capture_type>_<step>.delta as in delta
+ * mode (merge_result -s makes the count file from them).
+ *
+ * with n_parts > 1, the slices are shared by n_parts processes, each of
+ * which makes the slices of a range of ppos (part) and keeps them in its
+ * own slice files (.P<part>). a brown half-step only reads the black slice
+ * of its own ppos, and the brown slices of the other parts read by the
+ * black half-step of the part (ghosts) are kept up to date by the deltas
+ * of the slices which every part writes to the exchange directory
+ * (<delta>.S<ppos>). the coordinator waits for the changes of all parts in
+ * each step (ExchangeDir), tells them the sum, which ends the solver when
+ * it is zero, and joins the deltas of the previous step, which are read
+ * by then.
+ */
+template<int SIZE, int capture_type = 0>
+class OutOfCoreTableMaker {
+  typedef SliceKernel<SIZE> Kernel;
+  typedef std::vector<uint64_t, HugePageAllocator<uint64_t>> Buffer;
+  static constexpr bool NO_SYMMETRY() {
+    if (capture_type == 2 || capture_type == 3 || capture_type == 4) return true;
+    else return false;
+  }
+  static constexpr int ppos_size() {
+    if (NO_SYMMETRY())
+      return SIZE;
+    else
+      return Board<SIZE>::HSIZE();
+  }
+  static constexpr uint64_t SLICE_BYTES() { return Kernel::WORDS() * 8; }
+  // words
+  static constexpr uint64_t CHUNK() { return 4096; }
+
+  std::unique_ptr<SliceStore> store;
+  std::unique_ptr<WorkerPool> pool;
+  int part = 0, n_parts = 1;
+  std::unique_ptr<ExchangeDir> exchange;
+  // throws when the coordinator is gone (while waiting for it)
+  std::function<void()> check;
+  // the positions set in the slice by the half-step
+  Buffer diff;
+  std::vector<Buffer> acc, tmp;
+  uint64_t changed, total;
+
+  static std::string file_name(std::string const& color, std::string const& s) {
+    return color + "_" + std::to_string(SIZE) + "_" + std::to_string(capture_type) + "_" + s;
+  }
+  static std::string color(int step) {
+    return ((step & 1) == 1 ? "black" : "brown");
+  }
+  static int key(int color, int ppos) {
+    return color * ppos_size() + ppos;
+  }
+  static std::string delta_name(int step) {
+    return file_name(color(step), std::to_string(step) + ".delta");
+  }
+  static int first_ppos(int part, int n_parts) {
+    return ppos_size() * part / n_parts;
+  }
+  bool owned(int ppos) const {
+    return first_ppos(part, n_parts) <= ppos && ppos < first_ppos(part + 1, n_parts);
+  }
+  /*
+   * the slices of the part (its own ones and the ghosts)
+   */
+  std::vector<int> part_slices() const {
+    std::vector<int> r;
+    for (int ppos = 0; ppos < ppos_size(); ppos++) {
+      if (!owned(ppos)) continue;
+      for (int k : inputs(ppos, true))
+	if (std::find(r.begin(), r.end(), k) == r.end()) r.push_back(k);
+      r.push_back(key(Board<SIZE>::brown, ppos));
+    }
+    return r;
+  }
+  /*
+   * the slices read by the half-step on the slice of ppos (the first one
+   * is the slice which is set)
+   */
+  static std::vector<int> inputs(int ppos, bool is_black) {
+    if (!is_black) return {key(Board<SIZE>::brown, ppos), key(Board<SIZE>::black, ppos)};
+    std::vector<int> r{key(Board<SIZE>::black, ppos)};
+    for (int t : Board<SIZE>::neighbors(ppos)) {
+      int k = key(Board<SIZE>::brown, Kernel::move_slice(t, !NO_SYMMETRY()));
+      if (std::find(r.begin(), r.end(), k) == r.end()) r.push_back(k);
+    }
+    return r;
+  }
+  int next_slice(std::vector<bool> const& done, bool is_black) const {
+    int best = -1, best_cached = -1;
+    for (int ppos = 0; ppos < ppos_size(); ppos++) {
+      if (done[ppos]) continue;
+      int cached = 0;
+      for (int k : inputs(ppos, is_black)) cached += store->cached(k);
+      if (cached > best_cached) {
+	best = ppos;
+	best_cached = cached;
+      }
+    }
+    return best;
+  }
+  void brown_slice(int ppos) {
+    uint64_t const* black = store->get(key(Board<SIZE>::black, ppos), false);
+    auto moves = Kernel::brown_moves(ppos);
+    pool->run([&](int n) {
+	for (uint64_t j, e; pool->next(n, j, e); )
+	  for (uint64_t q = j; q < e; q++) diff[q] = Kernel::brown_word(black, moves, q);
+      }, Kernel::WORDS(), CHUNK());
+  }
+  void black_slice(int ppos) {
+    std::vector<int> ts;
+    std::vector<uint64_t const*> browns;
+    for (int t : Board<SIZE>::neighbors(ppos)) {
+      ts.push_back(t);
+      browns.push_back(store->get(key(Board<SIZE>::brown, Kernel::move_slice(t, !NO_SYMMETRY())), false));
+    }
+    std::vector<bool> used(pool->num_workers(), false);
+    pool->run([&](int n) {
+	for (uint64_t j, e; pool->next(n, j, e); ) {
+	  if (!used[n]) std::fill(acc[n].begin(), acc[n].end(), ~0ull);
+	  used[n] = true;
+	  Kernel::black_move(browns[j], ppos, ts[j], !NO_SYMMETRY(), &acc[n][0], &tmp[n][0]);
+	}
+      }, ts.size(), 1);
+    std::fill(diff.begin(), diff.end(), ~0ull);
+    for (int n = 0; n < pool->num_workers(); n++) {
+      if (!used[n]) continue;
+      for (uint64_t q = 0; q < Kernel::WORDS(); q++) diff[q] &= acc[n][q];
+    }
+  }
+  /*
+   * the black positions without any move (if the black piece at ppos can
+   * be captured)
+   */
+  void init_slice(int ppos) {
+    bool initial = TableMaker<SIZE, capture_type>::initial_ppos(ppos);
+    for (uint64_t q = 0; q < Kernel::WORDS(); q++) {
+      uint64_t r = (initial ? ~0ull : 0ull);
+      for (int t : Board<SIZE>::neighbors(ppos)) r &= Kernel::bit_mask(q, Kernel::index_bit(t, ppos));
+      diff[q] = r;
+    }
+  }
+  /*
+   * set the positions of diff in the slice and write them to
+   * <delta>.S<ppos>
+   */
+  void set_slice(int step, int ppos, std::string const& delta) {
+    uint64_t *w = store->get(key((step & 1) == 1 ? Board<SIZE>::black : Board<SIZE>::brown, ppos), true);
+    uint64_t base = static_cast<uint64_t>(ppos) << (SIZE - 1);
+    DeltaWriter dw(delta + ".S" + std::to_string(ppos));
+    for (uint64_t q = 0; q < Kernel::WORDS(); q++) {
+      uint64_t r = diff[q] & ~w[q];
+      w[q] |= r;
+      changed += popcnt(r);
+      for (; r != 0; r &= r - 1) dw.put(base + q * 64 + bsf(r));
+    }
+    dw.close();
+  }
+  /*
+   * the delta of the step is the deltas of the slices (<parts>.S<ppos>) in
+   * the order of ppos (each block of a delta file starts with its first
+   * index)
+   */
+  static void join_deltas(std::string const& parts, std::string const& delta) {
+    std::ofstream f(delta + ".tmp", std::ios::binary|std::ios::trunc);
+    for (int ppos = 0; ppos < ppos_size(); ppos++) {
+      std::string part = parts + ".S" + std::to_string(ppos);
+      std::ifstream in(part, std::ios::binary);
+      std::vector<char> buf(1 << 20);
+      for (;;) {
+	in.read(&buf[0], buf.size());
+	if (in.gcount() == 0) break;
+	f.write(&buf[0], in.gcount());
+      }
+      in.close();
+      std::remove(part.c_str());
+    }
+    f.close();
+    if (!f) throw std::runtime_error("cannot write " + delta + ".tmp");
+    if (std::rename((delta + ".tmp").c_str(), delta.c_str()) != 0)
+      throw std::runtime_error("cannot rename " + delta + ".tmp");
+  }
+  static void remove_deltas(std::string const& parts) {
+    for (int ppos = 0; ppos < ppos_size(); ppos++)
+      std::remove((parts + ".S" + std::to_string(ppos)).c_str());
+  }
+  /*
+   * set the brown positions of the step (written by the other parts) in
+   * the ghosts
+   */
+  void read_ghosts(int step) {
+    for (int k : part_slices()) {
+      int ppos = k % ppos_size();
+      if (k / ppos_size() != Board<SIZE>::brown || owned(ppos)) continue;
+      uint64_t *w = store->get(k, true);
+      uint64_t base = static_cast<uint64_t>(ppos) << (SIZE - 1);
+      DeltaReader dr(exchange->path(delta_name(step)) + ".S" + std::to_string(ppos));
+      for (uint64_t i; dr.next(i); ) {
+	i -= base;
+	w[i / 64] |= 1ull << (i % 64);
+      }
+    }
+  }
+  void run_step(int step) {
+    bool is_black = ((step & 1) == 1);
+    std::string delta = delta_name(step);
+    std::string parts = (n_parts > 1 ? exchange->path(delta) : delta);
+    uint64_t read0 = store->bytes_read, written0 = store->bytes_written;
+    changed = 0;
+    if (n_parts > 1 && is_black && step > 1) read_ghosts(step - 1);
+    std::vector<bool> done(ppos_size(), false);
+    int n_slices = 0;
+    for (int ppos = 0; ppos < ppos_size(); ppos++) {
+      done[ppos] = !owned(ppos);
+      n_slices += owned(ppos);
+    }
+    for (int i = 0; i < n_slices; i++) {
+      int ppos = next_slice(done, is_black);
+      done[ppos] = true;
+      // the slices to be read are in memory while the slice is made
+      for (int k : inputs(ppos, is_black)) store->get(k, false);
+      if (step == 1)
+	init_slice(ppos);
+      else if (is_black)
+	black_slice(ppos);
+      else
+	brown_slice(ppos);
+      set_slice(step, ppos, parts);
+    }
+    uint64_t delta_bytes = 0;
+    if (n_parts > 1) {
+      for (int ppos = 0; ppos < ppos_size(); ppos++)
+	if (owned(ppos)) delta_bytes += std::filesystem::file_size(parts + ".S" + std::to_string(ppos));
+      exchange->put_changed(step, part, changed);
+      total = exchange->wait_go(step, check);
+      std::cerr << "part=" << part << ", step=" << step << ", changed = " << changed << ", total = " << total << std::endl;
+    }
+    else {
+      join_deltas(parts, delta);
+      delta_bytes = std::filesystem::file_size(delta);
+      // as in TableMaker, the step without any change is not written
+      if (changed == 0) std::remove(delta.c_str());
+      total = changed;
+      std::cerr << "step=" << step << ", changed = " << changed << std::endl;
+    }
+    std::cerr << "io : slices read=" << store->bytes_read - read0 << ", written=" << store->bytes_written - written0 << ", delta=" << delta_bytes << " bytes" << std::endl;
+  }
+  /*
+   * wait for the changes of all parts in each step, and join the deltas
+   * of the step before it (which all parts have read)
+   */
+  static void coordinate(ExchangeDir const& exchange, int n_parts, std::function<void()> const& check) {
+    std::cerr << "start coordinating SIZE=" << SIZE << ", capture_type=" << capture_type << ", parts=" << n_parts << std::endl;
+    auto chrono_start = std::chrono::system_clock::now();
+    for (int step = 1; step < 256; step++) {
+      uint64_t total = exchange.wait_changed(step, n_parts, check);
+      if (step > 1) join_deltas(exchange.path(delta_name(step - 1)), delta_name(step - 1));
+      // the parts of the last step are not read by anyone
+      if (total == 0) remove_deltas(exchange.path(delta_name(step)));
+      exchange.put_go(step, total);
+      auto chrono_end = std::chrono::system_clock::now();
+      std::cerr << "step=" << step << ", changed = " << total << std::endl;
+      std::cerr << "Elapsed time:" << std::chrono::duration_cast<std::chrono::milliseconds>(chrono_end - chrono_start).count() << "[ms]" << std::endl;
+      if (total == 0) break;
+    }
+  }
+  /*
+   * the parts of the solver in child processes, and the coordinator in
+   * this one
+   */
+  void solve_local(int num_workers, uint64_t memory_limit, PartitionOptions const& po) {
+    ExchangeDir exchange(po.exchange);
+    exchange.clear();
+    std::vector<pid_t> pids;
+    for (int i = 0; i < po.parts; i++) {
+      pid_t pid = fork();
+      if (pid < 0) throw std::runtime_error("cannot fork");
+      if (pid == 0) {
+	PartitionOptions child = po;
+	child.part = i;
+	pid_t parent = getppid();
+	int status = 0;
+	try {
+	  solve_part(num_workers, memory_limit, child, [parent]() {
+	      if (getppid() != parent) throw std::runtime_error("the coordinator is gone");
+	    });
+	}
+	catch (std::exception& e) {
+	  std::cerr << "part=" << i << " : " << e.what() << std::endl;
+	  status = 1;
+	}
+	std::_Exit(status);
+      }
+      pids.push_back(pid);
+    }
+    auto wait_parts = [&](bool hang) {
+      for (pid_t& pid : pids) {
+	int status;
+	if (pid <= 0 || waitpid(pid, &status, hang ? 0 : WNOHANG) != pid) continue;
+	pid = 0;
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) throw std::runtime_error("a part of the solver failed");
+      }
+    };
+    try {
+      coordinate(exchange, po.parts, [&]() { wait_parts(false); });
+      wait_parts(true);
+    }
+    catch (...) {
+      for (pid_t pid : pids)
+	if (pid > 0) kill(pid, SIGTERM);
+      throw;
+    }
+    exchange.clear();
+  }
+  /*
+   * the part po.part of the solver (memory_limit == 0 : all slices of the
+   * part are in memory)
+   */
+  void solve_part(int num_workers, uint64_t memory_limit, PartitionOptions const& po, std::function<void()> check_) {
+    part = po.part;
+    n_parts = po.parts;
+    exchange = std::make_unique<ExchangeDir>(po.exchange);
+    check = check_;
+    std::cerr << "part=" << part << "/" << n_parts << " : ppos " << first_ppos(part, n_parts) << " - " << first_ppos(part + 1, n_parts) - 1 << std::endl;
+    solve(num_workers, memory_limit);
+  }
+public:
+  void solve(int num_workers, uint64_t memory_limit, PartitionOptions const& po) {
+    if (po.parts <= 1)
+      solve(num_workers, memory_limit);
+    else if (po.coordinator)
+      coordinate(ExchangeDir(po.exchange), po.parts, []() {});
+    else if (po.part >= 0)
+      solve_part(num_workers, memory_limit, po, []() {});
+    else
+      solve_local(num_workers, memory_limit, po);
+  }
+  void solve(int num_workers, uint64_t memory_limit) {
+    std::cerr << "start solving out of core SIZE=" << SIZE << ", capture_type=" << capture_type << ", num_workers=" << num_workers << ", memory_limit=" << memory_limit << std::endl;
+    size_t needed = 0;
+    for (int ppos = 0; ppos < ppos_size(); ppos++)
+      needed = std::max(needed, inputs(ppos, true).size());
+    // diff, and acc and tmp of each worker
+    size_t buffers = 1 + 2 * num_workers;
+    size_t capacity = part_slices().size();
+    if (memory_limit != 0) {
+      if (memory_limit / SLICE_BYTES() < needed + buffers)
+	throw std::runtime_error("--memory-limit is too small, it needs " + std::to_string((needed + buffers) * SLICE_BYTES()) + " bytes");
+      capacity = std::min<size_t>(memory_limit / SLICE_BYTES() - buffers, capacity);
+    }
+    std::cerr << "slice=" << SLICE_BYTES() << " bytes, slices in memory=" << capacity << "/" << part_slices().size() << std::endl;
+    std::vector<std::string> fnames;
+    for (int c = 0; c < 2; c++)
+      for (int ppos = 0; ppos < ppos_size(); ppos++)
+	fnames.push_back(file_name(c == Board<SIZE>::black ? "black" : "brown", "S" + std::to_string(ppos) + ".slice" + (n_parts > 1 ? ".P" + std::to_string(part) : "")));
+    store = std::make_unique<SliceStore>(fnames, Kernel::WORDS(), capacity);
+    pool = std::make_unique<WorkerPool>(num_workers);
+    diff = Buffer(Kernel::WORDS());
+    acc.assign(num_workers, Buffer(Kernel::WORDS()));
+    tmp.assign(num_workers, Buffer(Kernel::WORDS()));
+    auto chrono_start = std::chrono::system_clock::now();
+    for (int step = 1; step < 256; step++) {
+      run_step(step);
+      auto chrono_end = std::chrono::system_clock::now();
+      std::cerr << "Elapsed time:" << std::chrono::duration_cast<std::chrono::milliseconds>(chrono_end - chrono_start).count() << "[ms]" << std::endl;
+      if (total == 0) break;
+    }
+    std::cerr << "io : total slices read=" << store->bytes_read << ", written=" << store->bytes_written << " bytes" << std::endl;
+    store.reset();
+  }
+};
+
+template<int SIZE>
+bool solve_out_of_core(int capture_type, int n_workers, uint64_t memory_limit, PartitionOptions const& po) {
+  if (capture_type == 0)
+    OutOfCoreTableMaker<SIZE, 0>().solve(n_workers, memory_limit, po);
+  else if (capture_type == 1)
+    OutOfCoreTableMaker<SIZE, 1>().solve(n_workers, memory_limit, po);
+  else if (capture_type == 2)
+    OutOfCoreTableMaker<SIZE, 2>().solve(n_workers, memory_limit, po);
+  else if (capture_type == 3)
+    OutOfCoreTableMaker<SIZE, 3>().solve(n_workers, memory_limit, po);
+  else if (capture_type == 4)
+    OutOfCoreTableMaker<SIZE, 4>().solve(n_workers, memory_limit, po);
+  else
+    return false;
+  return true;
+}
+
+/*
+ * bytes with an optional suffix K, M or G
+ */
+uint64_t parse_bytes(std::string const& s) {
+  size_t pos;
+  uint64_t r = std::stoull(s, &pos);
+  std::string suffix = s.substr(pos);
+  if (suffix == "K" || suffix == "k") return r << 10;
+  if (suffix == "M" || suffix == "m") return r << 20;
+  if (suffix == "G" || suffix == "g") return r << 30;
+  if (!suffix.empty()) throw std::runtime_error("bad size " + s);
+  return r;
+}
+
+template<int SIZE, int capture_type>
+bool solve_table(int index_type, SolveOptions const& opts) {
+  if (index_type == COMPACT_INDEX)
+    TableMaker<SIZE, capture_type, COMPACT_INDEX>().solve(opts);
+  else if (index_type == D4_INDEX) {
+    // the other capture types are not symmetric
+    if constexpr (SIZE == 25 && capture_type <= 1)
+      TableMaker<SIZE, capture_type, D4_INDEX>().solve(opts);
+    else
+      return false;
+  }
+  else
+    TableMaker<SIZE, capture_type>().solve(opts);
+  return true;
+}
+
 int main(int ac, char **ag) {
   int board_size;
   int capture_type;
-  int n_workers;
+  SolveOptions opts;
+  bool layered;
+  bool all_types;
+  bool compact;
+  bool d4;
+  bool small_pages;
+  std::string memory_limit;
+  PartitionOptions partition;
   
   po::options_description options("all_options");
   options.add_options()
@@ -251,8 +2193,74 @@ int main(int ac, char **ag) {
      po::value<int>(&capture_type)->default_value(0),
      "capture type : 0 (ALL), 1(any corner), 2(one corner), 3(1,0), 4(2,0)")
     ("n-workers,w",
-     po::value<int>(&n_workers)->default_value(8),
+     po::value<int>(&opts.n_workers)->default_value(8),
      "number of workers")
+    ("frontier,f",
+     po::bool_switch(&opts.frontier)->default_value(false),
+     "push updates from the positions changed in the previous step when they are few")
+    ("counter,c",
+     po::bool_switch(&opts.counter)->default_value(false),
+     "count the remaining escapes of black positions instead of rescanning them")
+    ("layered,l",
+     po::bool_switch(&layered)->default_value(false),
+     "solve one layer of positions with the same number of browns at a time")
+    ("all-types",
+     po::bool_switch(&all_types)->default_value(false),
+     "solve the capture types 0-4 (SIZE 25) at once, one bit of a byte for each, and write the snapshots of the steps of each")
+    ("compact,z",
+     po::bool_switch(&compact)->default_value(false),
+     "store only the positions with an even number (<= 16) of browns")
+    ("d4,d",
+     po::bool_switch(&d4)->default_value(false),
+     "store the positions up to all symmetries of the board (SIZE 25, capture type 0 and 1)")
+    ("resume,r",
+     po::bool_switch(&opts.resume)->default_value(false),
+     "resume from the latest snapshots")
+    ("delta,s",
+     po::bool_switch(&opts.delta)->default_value(false),
+     "write only the positions set in each step (sparse .delta files)")
+    ("depth,p",
+     po::bool_switch(&opts.depth)->default_value(false),
+     "write count_<SIZE>_<capture_type>.bin directly instead of the snapshots of the steps")
+    ("numa,u",
+     po::bool_switch(&opts.numa)->default_value(false),
+     "pin the workers to cpus over the NUMA nodes and put the tables on the nodes of the workers sweeping them")
+    ("kernel,k",
+     po::bool_switch(&opts.kernel)->default_value(false),
+     "update the words of a slice at once in the half-steps which sweep the table (full index only)")
+    ("memory-limit,m",
+     po::value<std::string>(&memory_limit)->default_value(""),
+     "solve out of core with at most this many bytes (e.g. 16G) of the tables in memory (full index)")
+    ("parts",
+     po::value<int>(&partition.parts)->default_value(1),
+     "solve the slices (full index) in this many processes, each of which owns a range of ppos")
+    ("part",
+     po::value<int>(&partition.part)->default_value(-1),
+     "run only this part of --parts (the default is all parts in local processes)")
+    ("coordinator",
+     po::bool_switch(&partition.coordinator)->default_value(false),
+     "run only the coordinator of --parts")
+    ("exchange",
+     po::value<std::string>(&partition.exchange)->default_value("exchange"),
+     "the directory shared by the parts and the coordinator (without the files of an earlier run)")
+    ("metrics",
+     po::value<std::string>(&opts.metrics)->default_value(""),
+     "append the metrics of the solver to this file as newline-delimited JSON (- : stderr)")
+    ("metrics-port",
+     po::value<int>(&opts.metrics_port)->default_value(0),
+     "serve the metrics on http://127.0.0.1:<port>/ (all records) and /last")
+    ("perf",
+     po::bool_switch(&opts.perf)->default_value(false),
+     "report the hardware counters (cycles, instructions, LLC, dTLB and branch misses) of the init, the half-steps and the snapshots")
+    ("tile",
+     po::bool_switch(&opts.tile)->default_value(false),
+     "sweep the black positions in tiles of brown subsets over all ppos, sized to the last level cache (full index)")
+    ("batch",
+     po::value<int>(&opts.batch)->default_value(0),
+     "test the successors of this many positions at a time in the pull half-steps, after prefetching them (0 : one position at a time)")
+    ("small-pages,g",
+     po::bool_switch(&small_pages)->default_value(false),
+     "do not put the tables on huge pages")
     ;
   po::variables_map vm;
   try
@@ -271,17 +2279,59 @@ int main(int ac, char **ag) {
     std::cerr << options << std::endl;
     return 0;
   }
+  HugePages::enabled() = !small_pages;
+  if (all_types) {
+    if (board_size != 25 || layered || !memory_limit.empty() || partition.parts > 1 || compact || d4 || opts.frontier || opts.counter || opts.delta || opts.depth || opts.kernel || opts.resume) {
+      std::cerr << "--all-types needs SIZE 25 and the full index, and writes the snapshots of the steps (without -f, -c, -s, -p, -k, -r)" << std::endl;
+      return 1;
+    }
+    MultiTableMaker<25>().solve(opts.n_workers, opts.numa);
+    return 0;
+  }
+  if (!memory_limit.empty() || partition.parts > 1) {
+    if (layered || compact || d4) {
+      std::cerr << "--memory-limit and --parts need the full index" << std::endl;
+      return 1;
+    }
+    if (partition.part >= partition.parts) {
+      std::cerr << "--part must be less than --parts" << std::endl;
+      return 1;
+    }
+    bool ok = false;
+    uint64_t limit = (memory_limit.empty() ? 0 : parse_bytes(memory_limit));
+    if (board_size == 25)
+      ok = solve_out_of_core<25>(capture_type, opts.n_workers, limit, partition);
+    else if (board_size == 31)
+      ok = solve_out_of_core<31>(capture_type, opts.n_workers, limit, partition);
+    else if (board_size == 33)
+      ok = solve_out_of_core<33>(capture_type, opts.n_workers, limit, partition);
+    if (!ok) std::cerr << options << std::endl;
+    return 0;
+  }
+  if (layered) {
+    bool ok = false;
+    if (board_size == 25)
+      ok = solve_layered<25>(capture_type, opts.n_workers, opts.numa);
+    else if (board_size == 31)
+      ok = solve_layered<31>(capture_type, opts.n_workers, opts.numa);
+    else if (board_size == 33)
+      ok = solve_layered<33>(capture_type, opts.n_workers, opts.numa);
+    if (!ok) std::cerr << options << std::endl;
+    return 0;
+  }
+  int index_type = (d4 ? D4_INDEX : compact ? COMPACT_INDEX : FULL_INDEX);
+  bool ok = true;
   if (board_size == 25) {
     if (capture_type == 0)
-      TableMaker<25, 0>().solve(n_workers);
+      ok = solve_table<25, 0>(index_type, opts);
     else if (capture_type == 1)
-      TableMaker<25, 1>().solve(n_workers);
+      ok = solve_table<25, 1>(index_type, opts);
     else if (capture_type == 2)
-      TableMaker<25, 2>().solve(n_workers);
+      ok = solve_table<25, 2>(index_type, opts);
     else if (capture_type == 3)
-      TableMaker<25, 3>().solve(n_workers);
+      ok = solve_table<25, 3>(index_type, opts);
     else if (capture_type == 4)
-      TableMaker<25, 4>().solve(n_workers);
+      ok = solve_table<25, 4>(index_type, opts);
     else {
       std::cerr << options << std::endl;
       return 0;
@@ -289,14 +2339,15 @@ int main(int ac, char **ag) {
   }
   else if (board_size == 31) {
     if (capture_type == 0)
-      TableMaker<31, 0>().solve(n_workers);
+      ok = solve_table<31, 0>(index_type, opts);
   }
   else if (board_size == 33) {
     if (capture_type == 0)
-      TableMaker<33, 0>().solve(n_workers);
+      ok = solve_table<33, 0>(index_type, opts);
   }
   else {
     std::cerr << options << std::endl;
     return 0;
   }
+  if (!ok) std::cerr << options << std::endl;
 }
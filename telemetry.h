@@ -0,0 +1,180 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+/*
+ * the metrics of a solver, as newline-delimited JSON : each record is an
+ * object with an "event" on one line of the file (or of stderr for "-").
+ * with a port, a thread serves the records on 127.0.0.1 over HTTP
+ *  GET /      : all records so far
+ *  GET /last  : the last record of each event
+ * so that a run can be watched without reading its logs.
+ */
+class Telemetry {
+public:
+  /*
+   * a JSON object built field by field
+   */
+  class Record {
+    std::string event_;
+    std::ostringstream os;
+    bool first = true;
+    Record& key(std::string const& k) {
+      os << (first ? "{\"" : ",\"") << k << "\":";
+      first = false;
+      return *this;
+    }
+  public:
+    /*
+     * a record in an array of another one has no event
+     */
+    explicit Record(std::string const& event = "") :event_(event) {
+      os << std::setprecision(6);
+      if (!event.empty()) add("event", event);
+    }
+    std::string const& event() const {
+      return event_;
+    }
+    Record& add(std::string const& k, std::string const& v) {
+      key(k).os << '"' << v << '"';
+      return *this;
+    }
+    Record& add(std::string const& k, char const* v) {
+      return add(k, std::string(v));
+    }
+    template<typename T>
+    Record& add(std::string const& k, T v) {
+      key(k).os << +v;
+      return *this;
+    }
+    template<typename T>
+    Record& add(std::string const& k, std::vector<T> const& v) {
+      key(k).os << '[';
+      for (size_t i = 0; i < v.size(); i++) os << (i == 0 ? "" : ",") << +v[i];
+      os << ']';
+      return *this;
+    }
+    /*
+     * an array of records
+     */
+    Record& add(std::string const& k, std::vector<Record> const& v) {
+      key(k).os << '[';
+      for (size_t i = 0; i < v.size(); i++) os << (i == 0 ? "" : ",") << v[i].str();
+      os << ']';
+      return *this;
+    }
+    std::string str() const {
+      return (first ? "{" : os.str()) + "}";
+    }
+  };
+private:
+  std::ofstream file;
+  std::ostream *os = nullptr;
+  std::mutex lock;
+  std::vector<std::string> records;
+  std::map<std::string, std::string> last;
+  int listen_fd = -1;
+  std::atomic<bool> quit{false};
+  std::thread server;
+
+  void respond(int fd) {
+    char buf[1024];
+    ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return;
+    buf[n] = 0;
+    std::string request(buf), body;
+    bool found = true;
+    {
+      std::lock_guard<std::mutex> l_(lock);
+      if (request.compare(0, 10, "GET /last ") == 0)
+	for (auto const& r : last) body += r.second + "\n";
+      else if (request.compare(0, 6, "GET / ") == 0)
+	for (auto const& r : records) body += r + "\n";
+      else
+	found = false;
+    }
+    std::string response = std::string(found ? "HTTP/1.0 200 OK" : "HTTP/1.0 404 Not Found") +
+      "\r\nContent-Type: application/x-ndjson\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    for (size_t sent = 0; sent < response.size(); ) {
+      ssize_t k = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+      if (k <= 0) break;
+      sent += k;
+    }
+  }
+  void serve() {
+    while (!quit) {
+      pollfd p{listen_fd, POLLIN, 0};
+      if (poll(&p, 1, 200) <= 0) continue;
+      int fd = accept(listen_fd, nullptr, nullptr);
+      if (fd < 0) continue;
+      respond(fd);
+      close(fd);
+    }
+  }
+public:
+  /*
+   * fname : the file of the records ("-" : stderr, "" : none)
+   * port : the port of the HTTP server (0 : none)
+   */
+  Telemetry(std::string const& fname, int port) {
+    if (fname == "-")
+      os = &std::cerr;
+    else if (!fname.empty()) {
+      file.open(fname, std::ios::app);
+      if (!file) throw std::runtime_error("cannot open " + fname);
+      os = &file;
+    }
+    if (port == 0) return;
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listen_fd < 0 || bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0)
+      throw std::runtime_error("cannot listen on port " + std::to_string(port));
+    server = std::thread(&Telemetry::serve, this);
+  }
+  ~Telemetry() {
+    quit = true;
+    if (server.joinable()) server.join();
+    if (listen_fd >= 0) close(listen_fd);
+  }
+  /*
+   * keep : the record is in the records of GET / (frequent ones are only
+   * the last of their event)
+   */
+  void emit(Record const& r, bool keep = true) {
+    std::string s = r.str();
+    std::lock_guard<std::mutex> l_(lock);
+    if (os != nullptr) *os << s << std::endl;
+    if (keep) records.push_back(s);
+    last[r.event()] = s;
+  }
+  /*
+   * the resident memory of this process [bytes]
+   */
+  static uint64_t rss() {
+    std::ifstream f("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    f >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+  }
+};
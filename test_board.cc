@@ -1,4 +1,18 @@
 #include "board.h"
+#include "delta_file.h"
+#include "worker_pool.h"
+#include "huge_pages.h"
+#include "bit_table.h"
+#include "slice_kernel.h"
+#include "slice_store.h"
+#include "exchange_dir.h"
+#include "telemetry.h"
+#include "perf_counters.h"
+#include "cache_tiles.h"
+#include <atomic>
+#include <sstream>
+#include <random>
+#include <thread>
 #include <gtest/gtest.h>
 #include <vector>
 #include <string>
@@ -363,6 +377,467 @@ TEST_F(BoardTest, test_index) {
   }
 }
 
+TEST_F(BoardTest, test_prev_states) {
+  {
+    Board25 b("ooooo"
+	      "o...o"
+	      "o.X.o"
+	      "o...o"
+	      "oooooo");
+    // from any of 8 neighbors, restoring any of 3 pairs not containing it
+    std::vector<Board25> ps = b.prev_states_v();
+    EXPECT_EQ(64, ps.size());
+    Board25 b1("ooooo"
+	       "ooX.o"
+	       "o...o"
+	       "o..oo"
+	       "ooooo"
+	       "X");
+    EXPECT_TRUE(std::find(ps.begin(), ps.end(), b1) != ps.end());
+    Board25 b2("ooooo"
+	       "oX..o"
+	       "o...o"
+	       "o..oo"
+	       "ooooo"
+	       "X");
+    EXPECT_TRUE(std::find(ps.begin(), ps.end(), b2) == ps.end());
+  }
+  {
+    Board25 b("ooooo"
+	      "o...o"
+	      "o.X.o"
+	      "o...o"
+	      "oooooX");
+    std::vector<Board25> ps = b.prev_states_v();
+    std::vector<Board25> ps_slow = b.prev_states_slow();
+    EXPECT_EQ(ps_slow.size(), ps.size());
+    for (auto const& p : ps_slow)
+      EXPECT_TRUE(std::find(ps.begin(), ps.end(), p) != ps.end());
+  }
+  {
+    // a pair of browns around X cannot remain after the black move
+    Board25 b("ooooo"
+	      "..o.o"
+	      ".oX.o"
+	      "..o.o"
+	      "oooooo");
+    EXPECT_EQ(0, b.prev_states_v().size());
+  }
+}
+
+TEST_F(BoardTest, test_combination) {
+  EXPECT_EQ(1, combination.binomial(24, 0));
+  EXPECT_EQ(2704156, combination.binomial(24, 12));
+  EXPECT_EQ(0, combination.binomial(24, 25));
+  for (int k = 0; k <= 10; k++) {
+    uint64_t subset = (1ull << k) - 1;
+    for (uint64_t r = 0; r < combination.binomial(10, k); r++) {
+      EXPECT_EQ(r, combination.rank(subset));
+      EXPECT_EQ(subset, combination.unrank(r, k));
+      uint64_t next = Combination::next(subset);
+      if (k > 0) {
+	EXPECT_LT(subset, next);
+      }
+      EXPECT_EQ(k, popcnt(next));
+      subset = next;
+    }
+  }
+}
+
+TEST_F(BoardTest, test_compact_index) {
+  typedef CompactIndex<25, 15> Compact;
+  uint64_t size = 0;
+  for (int k = 0; k <= 16; k += 2)
+    size += 15 * combination.binomial(24, k);
+  EXPECT_EQ(size, Compact::size());
+  EXPECT_EQ(15, Compact::offset(2));
+  Board25 b("ooooo"
+	    "o...o"
+	    "o.X.o"
+	    "o...o"
+	    "ooooo"
+	    "X");
+  EXPECT_TRUE(Compact::reachable(b));
+  EXPECT_EQ(b, Compact::from_index(Compact::to_index(b), Board25::black));
+  EXPECT_FALSE(Compact::reachable(Board25::from_index((7ull << 24) | 7, Board25::black)));
+  // for_range() across the boundaries of ppos and of the number of browns
+  uint64_t starts[] = {0, Compact::offset(2) - 3, Compact::offset(4) - 1000, Compact::offset(16) - 1000, Compact::size() - 1000};
+  for (uint64_t start : starts) {
+    Compact::for_range(start, start + 1000, Board25::brown, [&](uint64_t i, Board25 const& p) {
+	EXPECT_TRUE(Compact::reachable(p));
+	EXPECT_EQ(Board25::brown, p.turn());
+	EXPECT_EQ(i, Compact::to_index(p));
+	EXPECT_EQ(p, Compact::from_index(i, Board25::brown));
+      });
+  }
+}
+
+/*
+ * D4Index numbers each position up to the symmetries exactly once
+ * (the center up to flip()), and canonical() is a symmetry of the position.
+ */
+TEST_F(BoardTest, test_d4_index) {
+  EXPECT_EQ((1ull << 24) + 5 * (((1ull << 10) * ((1ull << 10) + 1) / 2) << 4), d4index.size());
+  for (uint64_t i = 0; i < d4index.size(); i += 997) {
+    Board25 b = d4index.from_index(i, Board25::brown);
+    EXPECT_EQ(b, d4index.canonical(b));
+    EXPECT_EQ(i, d4index.to_index(b));
+  }
+  for (uint64_t index = 1; index < (25ull << 24); index += 7919) {
+    Board25 b = Board25::from_index(index, index % 2);
+    Board25 c = d4index.canonical(b);
+    EXPECT_EQ(b.normalize(), c.normalize());
+    EXPECT_EQ(c, d4index.canonical(c));
+    EXPECT_LT(d4index.to_index(c), d4index.size());
+    int images = 0;
+    bool found = false;
+    d4index.for_images(c, [&](Board25 const& n) {
+	EXPECT_EQ(c, d4index.canonical(n));
+	if (n == b) found = true;
+	images++;
+      });
+    EXPECT_TRUE(found);
+    EXPECT_LE(images, 8);
+  }
+  // for_range() across the boundaries of the classes
+  uint64_t starts[] = {0, 8396800 - 500, 3 * 8396800 - 500, 3 * 8396800 + (1ull << 24) - 500, d4index.size() - 1000};
+  for (uint64_t start : starts) {
+    d4index.for_range(start, start + 1000, Board25::black, [&](uint64_t i, Board25 const& b) {
+	EXPECT_EQ(d4index.from_index(i, Board25::black), b);
+      });
+  }
+}
+
+TEST_F(BoardTest, test_delta_file) {
+  std::vector<uint64_t> indices;
+  uint64_t i = 3;
+  for (int k = 0; k < 200000; k++) {
+    indices.push_back(i);
+    // small gaps and a few large ones
+    i += (k % 1000 == 0 ? (1ull << 40) + k : 1 + k % 300);
+  }
+  std::string fname = "test_delta_file.delta";
+  DeltaWriter w(fname);
+  for (uint64_t j : indices) w.put(j);
+  w.close();
+  EXPECT_EQ(w.size(), indices.size());
+  DeltaReader r(fname);
+  std::vector<uint64_t> read;
+  for (uint64_t j; r.next(j); ) read.push_back(j);
+  EXPECT_EQ(read, indices);
+  std::remove(fname.c_str());
+}
+
+TEST_F(BoardTest, test_worker_pool) {
+  WorkerPool pool(4);
+  for (uint64_t size : {0ull, 1ull, 1000003ull}) {
+    std::vector<std::atomic<int>> count(size);
+    pool.run([&](int n) {
+	for (uint64_t s, e; pool.next(n, s, e); ) {
+	  // make the first share slow, so that the others steal from it
+	  if (n == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));
+	  for (uint64_t i = s; i < e; i++) count[i]++;
+	}
+      }, size, 1000);
+    for (uint64_t i = 0; i < size; i++) EXPECT_EQ(count[i], 1) << "i=" << i;
+  }
+}
+
+/*
+ * share_owner(c) is the thread whose initial share has chunk c, and the
+ * pool on two (pretended) nodes counts the chunks stolen across them.
+ */
+TEST_F(BoardTest, test_worker_pool_shares) {
+  for (int w : {1, 3, 8})
+    for (uint64_t n_chunks : {1ull, 5ull, 1000ull})
+      for (int n = 0; n < w; n++)
+	for (uint64_t c = WorkerPool::share_begin(n_chunks, n, w); c < WorkerPool::share_begin(n_chunks, n + 1, w); c++)
+	  EXPECT_EQ(WorkerPool::share_owner(n_chunks, c, w), n) << "w=" << w << ", n_chunks=" << n_chunks << ", c=" << c;
+  NumaNodes numa;
+  EXPECT_EQ(numa.thread_cpus(4).size(), 4u);
+  WorkerPool pool(2, {-1, -1}, {0, 1});
+  pool.run([&](int n) {
+      for (uint64_t s, e; pool.next(n, s, e); )
+	if (n == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }, 100000, 1000);
+  std::ostringstream os;
+  pool.report(os);
+  EXPECT_NE(os.str().find("remote chunks = "), std::string::npos);
+  EXPECT_NE(os.str().find("/100"), std::string::npos);
+}
+
+/*
+ * tables of HugePageAllocator are zero when made, on any kind of pages
+ */
+TEST_F(BoardTest, test_huge_page_allocator) {
+  using Table = std::vector<uint8_t, HugePageAllocator<uint8_t>>;
+  for (bool enabled : {true, false}) {
+    HugePages::enabled() = enabled;
+    for (size_t size : {size_t(0), size_t(1000), HugePages::HUGE_SIZE(), 3 * HugePages::HUGE_SIZE() + 5}) {
+      Table t(size);
+      EXPECT_EQ(t.size(), size);
+      if (size >= HugePages::HUGE_SIZE()) {
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(t.data()) % (enabled ? HugePages::HUGE_SIZE() : 4096), 0u);
+      }
+      for (size_t i = 0; i < size; i += 997) {
+	EXPECT_EQ(t[i], 0) << "size=" << size << ", i=" << i;
+	t[i] = 1;
+      }
+      Table u = t;
+      EXPECT_TRUE(u == t);
+      t = Table(size);
+      EXPECT_EQ(std::count(t.begin(), t.end(), 0), static_cast<ptrdiff_t>(size));
+    }
+  }
+  HugePages::enabled() = true;
+  EXPECT_GT(HugePages::bytes(HugePages::SMALL) + HugePages::bytes(HugePages::TRANSPARENT) + HugePages::bytes(HugePages::EXPLICIT), 0u);
+}
+
+/*
+ * the slice kernels give the same bits as next_states() of each position,
+ * for random tables with and without the flip symmetry
+ */
+TEST_F(BoardTest, test_slice_kernel) {
+  using Kernel = SliceKernel<25>;
+  std::mt19937_64 rng(12345);
+  // 1/8 or 7/8 of the bits are set
+  std::vector<uint64_t> sparse(25 * Kernel::WORDS()), dense(25 * Kernel::WORDS());
+  for (uint64_t &w : sparse) w = rng() & rng() & rng();
+  for (uint64_t &w : dense) w = rng() | rng() | rng();
+  auto test = [](std::vector<uint64_t> const& t, uint64_t i) {
+    return ((t[i / 64] >> (i % 64)) & 1) != 0;
+  };
+  for (int ppos : {0, 2, 7, 12, 18, 24}) {
+    auto moves = Kernel::brown_moves(ppos);
+    uint64_t const* black = &sparse[ppos * Kernel::WORDS()];
+    for (int k = 0; k < 100000; k++) {
+      uint64_t s = rng() & ((1ull << 24) - 1);
+      bool expected = false;
+      for (auto n : Board25::from_index((uint64_t(ppos) << 24) | s, Board25::brown).next_states())
+	expected |= test(sparse, Board25(n).to_index());
+      bool r = ((Kernel::brown_word(black, moves, s / 64) >> (s % 64)) & 1) != 0;
+      ASSERT_EQ(r, expected) << "ppos=" << ppos << ", s=" << s;
+    }
+  }
+  std::vector<uint64_t> acc(Kernel::WORDS()), tmp(Kernel::WORDS());
+  for (bool flip : {false, true}) {
+    for (int ppos : {0, 2, 7, 12, 18, 24}) {
+      if (flip && ppos >= Board25::HSIZE()) continue;
+      Kernel::black_slice(&dense[0], ppos, flip, &acc[0], &tmp[0]);
+      int lost = 0;
+      for (int k = 0; k < 100000; k++) {
+	uint64_t s = rng() & ((1ull << 24) - 1);
+	bool expected = true;
+	for (auto n : Board25::from_index((uint64_t(ppos) << 24) | s, Board25::black).next_states()) {
+	  Board25 nb(n);
+	  if (flip && nb.ppos() >= uint64_t(Board25::HSIZE())) nb = nb.flip();
+	  expected &= test(dense, nb.to_index());
+	}
+	ASSERT_EQ(test(acc, s), expected) << "flip=" << flip << ", ppos=" << ppos << ", s=" << s;
+	lost += expected;
+      }
+      EXPECT_GT(lost, 0);
+    }
+  }
+}
+
+/*
+ * slices evicted from a SliceStore are written back and read again
+ */
+TEST_F(BoardTest, test_slice_store) {
+  std::vector<std::string> fnames;
+  for (int k = 0; k < 5; k++) fnames.push_back("test_slice_store_" + std::to_string(k) + ".slice");
+  {
+    SliceStore store(fnames, 1000, 2);
+    for (int k = 0; k < 5; k++) {
+      uint64_t *w = store.get(k, true);
+      EXPECT_EQ(w[999], 0u);
+      for (int q = 0; q < 1000; q++) w[q] = k * 1000 + q;
+    }
+    EXPECT_TRUE(store.cached(4));
+    EXPECT_FALSE(store.cached(0));
+    EXPECT_EQ(store.bytes_written, 3u * 8000);
+    for (int k : {0, 3, 1, 4, 2, 0}) {
+      uint64_t *w = store.get(k, false);
+      for (int q = 0; q < 1000; q += 99) EXPECT_EQ(w[q], uint64_t(k * 1000 + q)) << "k=" << k;
+    }
+    // every get misses with two slots
+    EXPECT_EQ(store.bytes_read, 5u * 8000 + 6u * 8000);
+  }
+  for (auto const& fname : fnames) EXPECT_FALSE(std::ifstream(fname).is_open());
+}
+
+/*
+ * a BitTable has the same bits as a byte bitmap while its blocks turn
+ * from lists to dense bytes, and after it is copied and made dense
+ */
+TEST_F(BoardTest, test_bit_table) {
+  uint64_t size = 3 * BitTable::BLOCK_BYTES() + 100;
+  BitTable t(size);
+  std::vector<uint8_t> ref(size);
+  std::mt19937_64 rng(5);
+  for (int i = 0; i < 2000; i++) {
+    // block 0 gets most of the bits, block 1 a few and block 2 none
+    uint64_t pos = (i % 100 == 0 ? BitTable::BLOCK_BITS() + rng() % 1000 : rng() % BitTable::BLOCK_BITS());
+    if (i % 3 == 0)
+      EXPECT_EQ(t.set_atomic(pos), (ref[pos / 8] & (1 << (pos % 8))) == 0);
+    else
+      t.set(pos);
+    ref[pos / 8] |= 1 << (pos % 8);
+  }
+  EXPECT_TRUE(t.is_dense(0));
+  EXPECT_FALSE(t.is_dense(1));
+  EXPECT_GT(t.sparse_bits(1), 0);
+  EXPECT_TRUE(t.empty(2));
+  uint64_t c = 0;
+  for (uint64_t pos = 0; pos < size * 8; pos++) {
+    EXPECT_EQ(t.test(pos), (ref[pos / 8] & (1 << (pos % 8))) != 0) << pos;
+    c += t.test(pos);
+  }
+  EXPECT_EQ(t.count(), c);
+  BitTable u(t);
+  std::vector<uint8_t> buf(BitTable::BLOCK_BYTES());
+  for (uint64_t b = 0; b < u.blocks(); b++) {
+    uint8_t const* d = u.block(b, &buf[0]);
+    EXPECT_TRUE(std::equal(d, d + u.block_size(b), &ref[b * BitTable::BLOCK_BYTES()])) << b;
+  }
+  EXPECT_FALSE(u.adapt());
+  uint8_t const* dense = u.dense();
+  EXPECT_TRUE(std::equal(ref.begin(), ref.end(), dense));
+  EXPECT_EQ(u.count(), c);
+  EXPECT_TRUE(u.empty(2));
+  // a block with few bits is loaded as a list
+  std::fill(buf.begin(), buf.end(), 0);
+  buf[0] = 1;
+  buf[4095] = 0x81;
+  t.load_block(0, &buf[0]);
+  EXPECT_FALSE(t.is_dense(0));
+  EXPECT_EQ(t.sparse_bits(0), 3);
+  EXPECT_TRUE(t.test(4095 * 8 + 7));
+  EXPECT_FALSE(t.test(1));
+  EXPECT_EQ(t.count(), 3u + t.sparse_bits(1));
+}
+
+/*
+ * the records of Telemetry are one JSON object per line
+ */
+TEST_F(BoardTest, test_telemetry) {
+  std::vector<Telemetry::Record> threads;
+  threads.push_back(std::move(Telemetry::Record().add("n", 0).add("busy_s", 1.5)));
+  Telemetry::Record r("step");
+  r.add("step", 3).add("mode", "pull").add("changed_by_browns", std::vector<uint64_t>{0, 2}).add("threads", threads);
+  EXPECT_EQ(r.str(), "{\"event\":\"step\",\"step\":3,\"mode\":\"pull\",\"changed_by_browns\":[0,2],\"threads\":[{\"n\":0,\"busy_s\":1.5}]}");
+  EXPECT_EQ(Telemetry::Record().str(), "{}");
+  std::remove("test_telemetry.ndjson");
+  {
+    Telemetry t("test_telemetry.ndjson", 0);
+    t.emit(r);
+    t.emit(Telemetry::Record("end").add("rss", Telemetry::rss()));
+  }
+  std::ifstream f("test_telemetry.ndjson");
+  std::string line;
+  std::getline(f, line);
+  EXPECT_EQ(line, r.str());
+  std::getline(f, line);
+  EXPECT_EQ(line.compare(0, 21, "{\"event\":\"end\",\"rss\":"), 0);
+  EXPECT_GT(Telemetry::rss(), 0u);
+  std::remove("test_telemetry.ndjson");
+}
+
+/*
+ * the counters which are available count a loop, and the others stay
+ * zero (wall-clock only)
+ */
+TEST_F(BoardTest, test_perf_counters) {
+  PerfCounters const& pc = PerfCounters::thread();
+  PerfCounters::Values start = pc.read();
+  volatile uint64_t x = 0;
+  for (int i = 0; i < 1000000; i++) x = x + i;
+  PerfCounters::Values d = pc.read() - start;
+  EXPECT_GT(d.seconds, 0.0);
+  for (int e = 0; e < PerfCounters::N_EVENTS; e++) {
+    if (pc.available(e)) {
+      EXPECT_GE(d.v[e], 0.0) << PerfCounters::name(e);
+    }
+    else {
+      EXPECT_EQ(d.v[e], 0.0) << PerfCounters::name(e);
+    }
+  }
+  if (pc.available(PerfCounters::INSTRUCTIONS)) {
+    EXPECT_GT(d.v[PerfCounters::INSTRUCTIONS], 1e6);
+  }
+  PerfCounters::Values sum;
+  sum += d;
+  sum += d;
+  EXPECT_DOUBLE_EQ(sum.seconds, 2 * d.seconds);
+}
+
+/*
+ * the coordinator sees the sum of the changes of the parts when all of
+ * them are there, and the parts see it in go_<step>
+ */
+TEST_F(BoardTest, test_exchange_dir) {
+  std::filesystem::remove_all("test_exchange_dir");
+  ExchangeDir ex("test_exchange_dir");
+  std::thread part1([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      ex.put_changed(1, 1, 7);
+      EXPECT_EQ(ex.wait_go(1, []() {}), 12u);
+    });
+  ex.put_changed(1, 0, 5);
+  EXPECT_EQ(ex.wait_changed(1, 2, []() {}), 12u);
+  ex.put_go(1, 12);
+  part1.join();
+  EXPECT_THROW(ex.wait_go(2, []() { throw std::runtime_error("gone"); }), std::runtime_error);
+  ex.clear();
+  EXPECT_TRUE(std::filesystem::is_empty("test_exchange_dir"));
+  std::filesystem::remove_all("test_exchange_dir");
+}
+
+TEST_F(BoardTest, test_cache_tiles) {
+  // 15 slices of 2^24 bits, 45 bits per column : 2^21 columns take 11.25MB of the 16MB
+  EXPECT_EQ(CacheTiles::width(32 << 20, 45, 1 << 24, 1, 4096), 1u << 21);
+  EXPECT_EQ(CacheTiles::width(32 << 20, 45, 1 << 24, 4, 4096), 1u << 19);
+  // at least a tile per worker, and never narrower than min_width
+  EXPECT_EQ(CacheTiles::width(1ull << 40, 45, 1 << 24, 8, 4096), 1u << 21);
+  EXPECT_EQ(CacheTiles::width(1 << 10, 45, 1 << 24, 8, 4096), 4096u);
+}
+
+static uint64_t edge_hash(uint64_t from, uint64_t to) {
+  uint64_t h = from * 0x9e3779b97f4a7c15ull ^ (to + 0x632be59bd9b4e019ull);
+  h ^= h >> 31;
+  h *= 0xbf58476d1ce4e5b9ull;
+  return h ^ (h >> 29);
+}
+
+/*
+ * every move (p -> n) found by next_states() is found by prev_states()
+ * of n exactly once and vice versa, for all positions of SIZE=25.
+ */
+TEST_F(BoardTest, test_prev_states_round_trip) {
+  uint64_t next_count[2][25] = {}, prev_count[2][25] = {};
+  uint64_t next_sum[2][25] = {}, prev_sum[2][25] = {};
+  for (int turn = 0; turn < 2; turn++) {
+    for (uint64_t index = 0; index < (25ull << 24); index++) {
+      Board25 b = Board25::from_index(index, turn);
+      for (auto n : b.next_states()) {
+	Board25 nb(n);
+	next_count[nb.turn()][nb.ppos()]++;
+	next_sum[nb.turn()][nb.ppos()] += edge_hash(b.v, n);
+      }
+      for (auto p : b.prev_states()) {
+	prev_count[turn][b.ppos()]++;
+	prev_sum[turn][b.ppos()] += edge_hash(p, b.v);
+      }
+    }
+  }
+  for (int turn = 0; turn < 2; turn++) {
+    for (int bpos = 0; bpos < 25; bpos++) {
+      EXPECT_EQ(next_count[turn][bpos], prev_count[turn][bpos]) << "turn=" << turn << ",bpos=" << bpos;
+      EXPECT_EQ(next_sum[turn][bpos], prev_sum[turn][bpos]) << "turn=" << turn << ",bpos=" << bpos;
+    }
+  }
+}
 
 int main(int ac, char **ag) {
   ::testing::InitGoogleTest(&ac, ag);
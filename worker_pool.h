@@ -0,0 +1,196 @@
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <cstdint>
+#include "numa_nodes.h"
+
+/*
+ * threads which live as long as the solver.
+ * run(f, size, chunk) calls f(n) on every thread n (0 <= n < num_workers()),
+ * and f takes the chunks of [0, size) by next(n, start, end) until it
+ * returns false. each thread starts with an equal share of consecutive
+ * chunks, and when its share is exhausted it steals the latter half of
+ * what is left of the share of another thread, so no thread idles while
+ * another one has work.
+ * busy(n) is the time which thread n spent in f during the last run, and
+ * items(n) the size of the chunks it took. done() is the size of the
+ * chunks taken so far in the run (while it runs).
+ * the threads may be pinned to cpus, and with the node of each thread the
+ * pool counts the chunks which a thread takes from the initial share of a
+ * thread on another node (remote chunks).
+ */
+class WorkerPool {
+  struct alignas(64) Share {
+    std::mutex lock;
+    uint64_t next = 0, end = 0;
+    uint64_t taken = 0, remote = 0, items = 0;
+  };
+  std::vector<Share> shares;
+  std::vector<int> cpus, nodes;
+  std::vector<std::thread> threads;
+  std::vector<double> busy_ms;
+  double wall_ms;
+  std::atomic<uint64_t> done_items{0};
+  std::function<void(int)> job;
+  uint64_t size, chunk, n_chunks;
+  std::mutex lock;
+  std::condition_variable start_cv, done_cv;
+  uint64_t generation;
+  int running;
+  bool quit;
+
+  void loop(int n) {
+    if (!cpus.empty()) NumaNodes::pin(cpus[n]);
+    uint64_t seen = 0;
+    for (;;) {
+      {
+	std::unique_lock<std::mutex> l_(lock);
+	start_cv.wait(l_, [&] { return quit || generation != seen; });
+	if (quit) return;
+	seen = generation;
+      }
+      auto start = std::chrono::steady_clock::now();
+      job(n);
+      busy_ms[n] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      std::lock_guard<std::mutex> l_(lock);
+      if (--running == 0) done_cv.notify_all();
+    }
+  }
+  /*
+   * move the latter half of the chunks left to another thread to thread n
+   */
+  bool steal(int n) {
+    for (int k = 1; k < num_workers(); k++) {
+      Share &victim = shares[(n + k) % num_workers()];
+      uint64_t s, e;
+      {
+	std::lock_guard<std::mutex> l_(victim.lock);
+	if (victim.next == victim.end) continue;
+	s = victim.end - (victim.end - victim.next + 1) / 2;
+	e = victim.end;
+	victim.end = s;
+      }
+      // nobody steals from an empty share, so the chunks are not lost meanwhile
+      std::lock_guard<std::mutex> l_(shares[n].lock);
+      shares[n].next = s;
+      shares[n].end = e;
+      return true;
+    }
+    return false;
+  }
+public:
+  /*
+   * cpus[n] (if any) is the cpu of thread n and nodes[n] its node
+   */
+  explicit WorkerPool(int num_workers, std::vector<int> const& cpus_ = {}, std::vector<int> const& nodes_ = {})
+    :shares(num_workers), cpus(cpus_), nodes(nodes_), busy_ms(num_workers, 0.0), wall_ms(0.0), size(0), chunk(1), n_chunks(0), generation(0), running(0), quit(false) {
+    if (nodes.empty()) nodes.assign(num_workers, 0);
+    for (int n = 0; n < num_workers; n++)
+      threads.emplace_back(&WorkerPool::loop, this, n);
+  }
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> l_(lock);
+      quit = true;
+    }
+    start_cv.notify_all();
+    for (auto &t : threads) t.join();
+  }
+  int num_workers() const {
+    return static_cast<int>(shares.size());
+  }
+  int node(int n) const {
+    return nodes[n];
+  }
+  /*
+   * the first chunk of the initial share of thread n
+   */
+  static uint64_t share_begin(uint64_t n_chunks, int n, int num_workers) {
+    return n_chunks * n / num_workers;
+  }
+  /*
+   * the thread whose initial share has chunk c
+   */
+  static int share_owner(uint64_t n_chunks, uint64_t c, int num_workers) {
+    return static_cast<int>(((c + 1) * num_workers - 1) / n_chunks);
+  }
+  void run(std::function<void(int)> f, uint64_t size_, uint64_t chunk_) {
+    auto start = std::chrono::steady_clock::now();
+    n_chunks = (size_ + chunk_ - 1) / chunk_;
+    for (int n = 0; n < num_workers(); n++) {
+      shares[n].next = share_begin(n_chunks, n, num_workers());
+      shares[n].end = share_begin(n_chunks, n + 1, num_workers());
+      shares[n].taken = shares[n].remote = shares[n].items = 0;
+    }
+    done_items = 0;
+    job = f;
+    size = size_;
+    chunk = chunk_;
+    {
+      std::lock_guard<std::mutex> l_(lock);
+      running = num_workers();
+      generation++;
+    }
+    start_cv.notify_all();
+    std::unique_lock<std::mutex> l_(lock);
+    done_cv.wait(l_, [&] { return running == 0; });
+    wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+  /*
+   * the next chunk [start, end) of thread n. returns false if there is no chunk left.
+   */
+  bool next(int n, uint64_t &start, uint64_t &end) {
+    for (;;) {
+      {
+	std::lock_guard<std::mutex> l_(shares[n].lock);
+	if (shares[n].next < shares[n].end) {
+	  uint64_t c = shares[n].next++;
+	  shares[n].taken++;
+	  if (nodes[share_owner(n_chunks, c, num_workers())] != nodes[n]) shares[n].remote++;
+	  start = c * chunk;
+	  end = std::min(start + chunk, size);
+	  shares[n].items += end - start;
+	  done_items.fetch_add(end - start, std::memory_order_relaxed);
+	  return true;
+	}
+      }
+      if (!steal(n)) return false;
+    }
+  }
+  double busy(int n) const {
+    return busy_ms[n];
+  }
+  uint64_t items(int n) const {
+    return shares[n].items;
+  }
+  uint64_t done() const {
+    return done_items.load(std::memory_order_relaxed);
+  }
+  double wall() const {
+    return wall_ms;
+  }
+  /*
+   * the busy time of each thread and the wall time of the last run [ms]
+   * (and the remote chunks of the run if the threads are on several nodes)
+   */
+  void report(std::ostream &os) const {
+    os << "busy[ms] =";
+    for (double b : busy_ms) os << " " << static_cast<uint64_t>(b);
+    os << ", wall[ms] = " << static_cast<uint64_t>(wall_ms);
+    if (std::count(nodes.begin(), nodes.end(), nodes[0]) != num_workers()) {
+      uint64_t taken = 0, remote = 0;
+      for (auto const& s : shares) {
+	taken += s.taken;
+	remote += s.remote;
+      }
+      os << ", remote chunks = " << remote << "/" << taken;
+    }
+    os << std::endl;
+  }
+};